@@ -73,21 +73,65 @@ void noInterrupts();
 #define sei() interrupts()
 #define cli() noInterrupts()
 
+// Port-wide GPIO access.  Only the pins set in mask are changed, all at once
+void digitalWritePort(uint32_t mask, uint32_t value);
+void digitalSetPort(uint32_t mask);
+void digitalClearPort(uint32_t mask);
+void digitalTogglePort(uint32_t mask);
+uint32_t digitalReadPort();
+
+#ifdef __cplusplus
+// PIO+DMA shiftOut/shiftIn of whole buffers.  latchPin is pulsed HIGH after shifting out (74HC595)
+// or LOW before shifting in (74HC165)
+void shiftOutBuffer(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, const void *buf, size_t len, uint32_t hz = 8000000, pin_size_t latchPin = 255);
+void shiftInBuffer(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, void *buf, size_t len, uint32_t hz = 8000000, pin_size_t latchPin = 255);
+#endif
+
 // ADC RP2040-specific calls
 void analogReadResolution(int bits);
 #ifdef __cplusplus
 float analogReadTemp(float vref = 3.3);  // Returns core temp in Centigrade
+// Free-running ADC sampling into a DMA buffer, analogRead/analogReadTemp then return immediately.
+// Mask bits 0-3 are A0-A3, bit 4 is the temperature sensor.  hz is per channel, average is 1-256
+bool analogReadBackground(uint32_t channelMask, uint32_t hz = 1000, int average = 1);
+void analogReadBackgroundEnd();
 #endif
 
 // PWM RP2040-specific calls
 void analogWriteFreq(uint32_t freq);
 void analogWriteRange(uint32_t range);
 void analogWriteResolution(int res);
+#ifdef __cplusplus
+// Per-pin (actually per-slice, 2 pins share one) frequency and range.  0 returns to the global setting
+void analogWritePinFreq(pin_size_t pin, uint32_t freq);
+void analogWritePinRange(pin_size_t pin, uint32_t range);
+// DMA playback of raw PWM levels, 1 per PWM period.  The other pin on the slice mirrors the waveform
+bool analogWriteWaveform(pin_size_t pin, const uint16_t *levels, size_t count, bool repeat = false);
+bool analogWriteWaveformBusy(pin_size_t pin);
+void analogWriteWaveformStop(pin_size_t pin);
+#endif
 
 #ifdef __cplusplus
 } // extern "C"
 #endif
 
+#ifdef __cplusplus
+// GPIO interrupts routed to a specific core (0 or 1).  The plain attachInterrupt calls use the calling core
+void attachInterruptCore(pin_size_t pin, voidFuncPtr callback, PinStatus mode, int core);
+void attachInterruptParamCore(pin_size_t pin, voidFuncPtrParam callback, PinStatus mode, void *param, int core);
+
+// Edge-event queue mode, the IRQ only records the pin, edge, and time for later processing
+typedef struct {
+    uint32_t time; // time_us_32() when the IRQ ran
+    uint8_t pin;
+    PinStatus mode; // RISING, FALLING, or CHANGE if both edges happened before the IRQ could run
+} GPIOEvent;
+void attachInterruptEvent(pin_size_t pin, PinStatus mode, int core = -1);
+bool readInterruptEvent(GPIOEvent *ev);
+int availableInterruptEvents();
+uint32_t droppedInterruptEvents();
+#endif
+
 // FreeRTOS potential calls
 extern bool __isFreeRTOS;
 
@@ -0,0 +1,250 @@
+/*
+    Cooperative tasks for the bare-metal loop()/loop1()
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AsyncTask.h"
+#include <pico/time.h>
+#include "_freertos.h"
+
+// Per-core scheduler state, only ever touched by the owning core
+static AsyncTask *_tasks[2];
+static AsyncTask *_current[2];
+static uint32_t *_loopSP[2];
+
+// An IRQ (or fault) handler calling delay() or yield() must not switch stacks
+// out from under the interrupted code, so it gets the plain behaviour
+static inline bool _inHandler() {
+    return __get_current_exception() != 0;
+}
+
+// Pushes r4-r11 and the return address, stores the SP in *save, then pops the
+// same from newSP.  Returns to the caller when something switches back to it.
+extern "C" void __attribute__((naked)) __async_switch(uint32_t ** /* save */, uint32_t * /* newSP */) {
+    asm volatile(
+        "push {r4-r7, lr}\n"
+        "mov r2, r8\n"
+        "mov r3, r9\n"
+        "mov r4, r10\n"
+        "mov r5, r11\n"
+        "push {r2-r5}\n"
+        "mov r2, sp\n"
+        "str r2, [r0]\n"
+        "mov sp, r1\n"
+        "pop {r2-r5}\n"
+        "mov r8, r2\n"
+        "mov r9, r3\n"
+        "mov r10, r4\n"
+        "mov r11, r5\n"
+        "pop {r4-r7, pc}\n"
+    );
+}
+
+AsyncTask::AsyncTask(std::function<void()> fn, size_t stackSize) : _fn(fn) {
+    _stackSize = (stackSize + 7) & ~7;
+    _stack = nullptr;
+    _sp = nullptr;
+    _next = nullptr;
+    _wakeUs = 0;
+    _cond = nullptr;
+    _core = -1;
+    _done = false;
+}
+
+AsyncTask::~AsyncTask() {
+    _unlink();
+    free(_stack);
+}
+
+bool AsyncTask::begin() {
+    if (__isFreeRTOS) {
+        DEBUGCORE("ERROR: AsyncTask is not available under FreeRTOS\n");
+        return false;
+    }
+    if (running()) {
+        return false;
+    }
+    if (!_stack) {
+        _stack = (uint32_t *)malloc(_stackSize);
+        if (!_stack) {
+            DEBUGCORE("ERROR: AsyncTask unable to allocate stack\n");
+            return false;
+        }
+    }
+    // Build the frame __async_switch() expects, "returning" to _entry with an 8-byte aligned SP
+    _sp = _stack + _stackSize / sizeof(uint32_t) - 9;
+    for (int i = 0; i < 8; i++) {
+        _sp[i] = 0;
+    }
+    _sp[8] = (uint32_t)_entry; // Already has the Thumb bit set
+    _wakeUs = 0;
+    _cond = nullptr;
+    _done = false;
+    _core = get_core_num();
+    // Add to the end, so tasks run in the order they were started
+    _next = nullptr;
+    AsyncTask **p = &_tasks[_core];
+    while (*p) {
+        p = &(*p)->_next;
+    }
+    *p = this;
+    return true;
+}
+
+void AsyncTask::_unlink() {
+    if (_core < 0) {
+        return;
+    }
+    for (AsyncTask **p = &_tasks[_core]; *p; p = &(*p)->_next) {
+        if (*p == this) {
+            *p = _next;
+            break;
+        }
+    }
+    _next = nullptr;
+    _core = -1;
+}
+
+AsyncTask *AsyncTask::current() {
+    return _current[get_core_num()];
+}
+
+void AsyncTask::_entry() {
+    AsyncTask *t = _current[get_core_num()];
+    t->_fn();
+    t->_done = true;
+    _switchOut();
+    while (true) { /* Never switched back to */ }
+}
+
+void AsyncTask::_switchIn() {
+    int core = _core;
+    _current[core] = this;
+    __async_switch(&_loopSP[core], _sp);
+    _current[core] = nullptr;
+}
+
+void AsyncTask::_switchOut() {
+    int core = get_core_num();
+    __async_switch(&_current[core]->_sp, _loopSP[core]);
+}
+
+void AsyncTask::run() {
+    int core = get_core_num();
+    if (_current[core] || _inHandler()) {
+        return; // Only runs from loop()/loop1()
+    }
+    AsyncTask *t = _tasks[core];
+    while (t) {
+        uint64_t now = time_us_64();
+        if ((now >= t->_wakeUs) || (t->_cond && (*t->_cond)())) {
+            t->_switchIn();
+        }
+        // The task may have started or stopped others while running, so only look at the list now
+        AsyncTask *next = t->_next;
+        if (t->_done) {
+            t->_unlink();
+        }
+        t = next;
+    }
+}
+
+bool AsyncTask::waitFor(std::function<bool()> cond, uint32_t timeoutMs) {
+    if (cond()) {
+        return true;
+    }
+    int core = get_core_num();
+    uint64_t until = (timeoutMs == UINT32_MAX) ? UINT64_MAX : time_us_64() + timeoutMs * 1000ULL;
+    AsyncTask *t = _current[core];
+    if (t && !_inHandler()) {
+        // The scheduler polls cond() from loop() and only switches back here once it's true
+        t->_cond = &cond;
+        t->_wakeUs = until;
+        _switchOut();
+        t->_cond = nullptr;
+        return cond();
+    }
+    while (!cond()) {
+        if (time_us_64() >= until) {
+            return false;
+        }
+        run();
+    }
+    return true;
+}
+
+bool AsyncTask::_delay(uint32_t ms) {
+    if (_inHandler()) {
+        return false;
+    }
+    int core = get_core_num();
+    AsyncTask *t = _current[core];
+    if (t) {
+        t->_wakeUs = time_us_64() + ms * 1000ULL;
+        _switchOut();
+        return true;
+    }
+    if (!_tasks[core]) {
+        return false;
+    }
+    // Keep the tasks going while loop() waits, sleeping when none can be ready before the next wakeup
+    uint64_t until = time_us_64() + ms * 1000ULL;
+    while (true) {
+        run();
+        uint64_t wake = until;
+        for (t = _tasks[core]; t; t = t->_next) {
+            wake = t->_cond ? 0 : min(wake, t->_wakeUs);
+            if (!wake) {
+                break;
+            }
+        }
+        uint64_t now = time_us_64();
+        if (now >= until) {
+            return true;
+        }
+        if (wake > now) {
+            sleep_until(from_us_since_boot(wake));
+        }
+    }
+}
+
+void AsyncTask::_yield() {
+    if (_inHandler()) {
+        return;
+    }
+    AsyncTask *t = _current[get_core_num()];
+    if (t) {
+        t->_wakeUs = 0;
+        _switchOut();
+    } else {
+        run();
+    }
+}
+
+// Only linked in when a sketch uses AsyncTask
+extern "C" bool __asyncDelay(unsigned long ms) {
+    return AsyncTask::_delay(ms);
+}
+
+extern "C" void __asyncYield() {
+    AsyncTask::_yield();
+}
+
+void __asyncRun() {
+    AsyncTask::run();
+}
@@ -0,0 +1,95 @@
+/*
+    Cooperative tasks for the bare-metal loop()/loop1()
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    Each AsyncTask runs a function on its own small stack, on the core that
+    started it, taking turns with loop() (or loop1()).  A task only gives up
+    the CPU when it calls delay(), yield() or AsyncTask::waitFor(), so no
+    locking is needed between tasks on the same core.  Every blocking call in
+    the core and libraries already waits using delay(), so a task doing
+    WiFiClient::connect(), read() with a timeout, or hostByName() only
+    suspends itself while loop() and the other tasks keep running.
+
+        AsyncTask t([]() {
+            WiFiClient c;
+            c.connect("example.com", 80);   // Other tasks run while waiting
+            ...
+        });
+        t.begin();
+
+    Not available under FreeRTOS, use real tasks there.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+class AsyncTask {
+public:
+    // The stack also has to hold any IRQ which interrupts the task
+    AsyncTask(std::function<void()> fn, size_t stackSize = 2048);
+
+    // Stops the task if it has not finished.  Never delete the running task from itself
+    ~AsyncTask();
+
+    // Starts the task on the calling core.  False if out of memory or already started
+    bool begin();
+
+    bool running() const {
+        return _stack && !_done;
+    }
+
+    bool done() const {
+        return _done;
+    }
+
+    // The task running on this core, nullptr in loop()/loop1()
+    static AsyncTask *current();
+
+    // Waits until cond() is true, true unless the timeout passed first.  In a task
+    // only this task waits, and cond() is checked by the scheduler without switching
+    // back to it.  In loop() the other tasks run while waiting.  From an IRQ handler
+    // it just polls cond(), nothing else runs
+    static bool waitFor(std::function<bool()> cond, uint32_t timeoutMs = UINT32_MAX);
+
+    // Runs each ready task on this core once, called after every loop()
+    static void run();
+
+    // Internal, used by delay() and yield()
+    static bool _delay(uint32_t ms);
+    static void _yield();
+
+private:
+    static void _entry();
+    void _switchIn();
+    static void _switchOut();
+    void _unlink();
+
+    std::function<void()> _fn;
+    size_t _stackSize;
+    uint32_t *_stack;
+    uint32_t *_sp;
+    AsyncTask *_next;
+    uint64_t _wakeUs;                   // Don't run before this
+    std::function<bool()> *_cond;       // Or until this is true
+    int _core;
+    bool _done;
+};
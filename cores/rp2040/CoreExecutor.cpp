@@ -0,0 +1,165 @@
+/*
+    Work-offload executor for running jobs on the other core
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CoreExecutor.h"
+#include <hardware/sync.h>
+#include "_freertos.h"
+
+CoreExecutor coreExecutor;
+
+// Protects the job lists and future refcounts.  Only ever held for a few instructions
+static spin_lock_t *_execLock = nullptr;
+
+CoreExecutor::CoreExecutor() {
+    _execLock = spin_lock_init(spin_lock_claim_unused(true));
+    for (int i = 0; i < 3; i++) {
+        _head[i] = nullptr;
+        _tail[i] = nullptr;
+    }
+    _pending = 0;
+    _core0 = false;
+}
+
+void CoreExecutor::_ref(FutureStateBase *s) {
+    uint32_t save = spin_lock_blocking(_execLock);
+    s->refs++;
+    spin_unlock(_execLock, save);
+}
+
+void CoreExecutor::_unref(FutureStateBase *s) {
+    uint32_t save = spin_lock_blocking(_execLock);
+    bool last = !--s->refs;
+    spin_unlock(_execLock, save);
+    if (last) {
+        delete s;
+    }
+}
+
+bool CoreExecutor::enqueue(Job *j, Priority prio) {
+    int p = constrain((int)prio, (int)Low, (int)High);
+    j->next = nullptr;
+    uint32_t save = spin_lock_blocking(_execLock);
+    if (_tail[p]) {
+        _tail[p]->next = j;
+    } else {
+        _head[p] = j;
+    }
+    _tail[p] = j;
+    _pending = _pending + 1;
+    spin_unlock(_execLock, save);
+    __sev(); // Wake up core 1 if it's waiting for work
+    return true;
+}
+
+CoreExecutor::Job *CoreExecutor::dequeue() {
+    Job *j = nullptr;
+    uint32_t save = spin_lock_blocking(_execLock);
+    for (int p = High; p >= Low; p--) {
+        if (_head[p]) {
+            j = _head[p];
+            _head[p] = j->next;
+            if (!_head[p]) {
+                _tail[p] = nullptr;
+            }
+            _pending = _pending - 1;
+            break;
+        }
+    }
+    spin_unlock(_execLock, save);
+    return j;
+}
+
+bool CoreExecutor::post(void (*fn)(void *), void *arg, Priority prio) {
+    Job *j = new Job;
+    if (!j) {
+        return false;
+    }
+    j->fn = fn;
+    j->arg = arg;
+    return enqueue(j, prio);
+}
+
+bool CoreExecutor::post(std::function<void()> fn, Priority prio) {
+    Job *j = new Job;
+    if (!j) {
+        return false;
+    }
+    j->fn = nullptr;
+    j->arg = nullptr;
+    j->func = std::move(fn);
+    return enqueue(j, prio);
+}
+
+size_t CoreExecutor::pending() {
+    return _pending;
+}
+
+bool CoreExecutor::runOne() {
+    Job *j = dequeue();
+    if (!j) {
+        return false;
+    }
+    if (j->fn) {
+        j->fn(j->arg);
+    } else {
+        j->func();
+    }
+    delete j;
+    return true;
+}
+
+void CoreExecutor::run(bool block) {
+    while (true) {
+        while (runOne()) {
+            /* noop */
+        }
+        if (!block) {
+            return;
+        }
+        // Under FreeRTOS let lower priority tasks on this core run, otherwise sleep until an enqueue's SEV
+        if (__isFreeRTOS) {
+            delay(1);
+        } else {
+            __wfe();
+        }
+    }
+}
+
+void CoreExecutor::_help() {
+    // Waiting on a future from a worker core must keep running jobs, or it could wait on itself forever
+    if ((get_core_num() == 1) || _core0) {
+        runOne();
+    }
+    yield();
+}
+
+void CoreExecutor::_poll(bool block) {
+    if (get_core_num() == 1) {
+        run(block);
+    } else if (_core0) {
+        // Core 0 only runs 1 job per loop() so it stays responsive
+        runOne();
+    }
+}
+
+// Called from the core's main loops, only linked in when coreExecutor is used
+void __executorRun(bool block) {
+    coreExecutor._poll(block);
+}
@@ -0,0 +1,212 @@
+/*
+    Work-offload executor for running jobs on the other core
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    Jobs submitted to coreExecutor run on core 1 (and optionally core 0, between
+    calls to loop()) in priority order, FIFO within a priority.  Simply using
+    coreExecutor in a sketch or library starts core 1, even without setup1()/loop1().
+    If loop1() exists, jobs run on core 1 between its calls.
+
+        auto f = coreExecutor.submit([]() { return crunch(); });
+        ...
+        int result = f.get();
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <pico/time.h>
+#include <hardware/sync.h>
+
+class CoreExecutor;
+extern CoreExecutor coreExecutor;
+
+// Shared between a Future and the job which completes it
+class FutureStateBase {
+public:
+    virtual ~FutureStateBase() { /* noop */ }
+    volatile bool done = false;
+    int refs = 2; // Future + job, only changed by CoreExecutor under its lock
+};
+
+template<typename T>
+class FutureState : public FutureStateBase {
+public:
+    T value;
+};
+
+template<>
+class FutureState<void> : public FutureStateBase {
+};
+
+class CoreExecutor {
+public:
+    typedef enum {
+        Low = 0,
+        Normal = 1,
+        High = 2
+    } Priority;
+
+    CoreExecutor();
+
+    // Which cores run jobs, bit 0 = core 0, bit 1 = core 1.  Core 1 always runs them,
+    // adding core 0 runs at most 1 job after every loop()
+    void setCores(uint8_t mask) {
+        _core0 = mask & 1;
+    }
+
+    // Fire-and-forget, the cheapest way to hand off work.  False if out of memory
+    bool post(void (*fn)(void *), void *arg, Priority prio = Normal);
+    bool post(std::function<void()> fn, Priority prio = Normal);
+
+    // Returns a future which becomes ready() when the job completes
+    template<typename F>
+    auto submit(F &&fn, Priority prio = Normal);
+
+    // Jobs queued but not yet started
+    size_t pending();
+
+    // Runs queued jobs on the calling core.  With block, waits for new jobs forever
+    void run(bool block = false);
+
+    // Internal, only used by Future
+    static void _unref(FutureStateBase *s);
+    static void _ref(FutureStateBase *s);
+    void _help();
+    void _poll(bool block);
+
+private:
+    typedef struct Job {
+        struct Job *next;
+        void (*fn)(void *);
+        void *arg;
+        std::function<void()> func;
+    } Job;
+
+    bool enqueue(Job *j, Priority prio);
+    Job *dequeue();
+    bool runOne();
+
+    Job *_head[3];
+    Job *_tail[3];
+    volatile size_t _pending;
+    bool _core0;
+};
+
+template<typename T>
+class Future {
+public:
+    Future() : _s(nullptr) { /* noop */ }
+    explicit Future(FutureState<T> *s) : _s(s) { /* noop */ }
+    Future(const Future &o) : _s(o._s) {
+        if (_s) {
+            CoreExecutor::_ref(_s);
+        }
+    }
+    Future(Future &&o) : _s(o._s) {
+        o._s = nullptr;
+    }
+    Future &operator=(Future o) {
+        std::swap(_s, o._s);
+        return *this;
+    }
+    ~Future() {
+        if (_s) {
+            CoreExecutor::_unref(_s);
+        }
+    }
+
+    // False if the job could not be queued
+    bool valid() const {
+        return _s != nullptr;
+    }
+
+    bool ready() const {
+        return _s && _s->done;
+    }
+
+    // True if the job finished within the timeout
+    bool wait(uint32_t timeoutMs) const {
+        if (!_s) {
+            return false;
+        }
+        absolute_time_t until = make_timeout_time_ms(timeoutMs);
+        while (!_s->done) {
+            if (time_reached(until)) {
+                return false;
+            }
+            _idle();
+        }
+        return true;
+    }
+
+    void wait() const {
+        while (_s && !_s->done) {
+            _idle();
+        }
+    }
+
+    // Blocks until done
+    template<typename U = T>
+    typename std::enable_if < !std::is_void<U>::value, U >::type get() const {
+        wait();
+        return _s ? _s->value : U();
+    }
+
+private:
+    static void _idle() {
+        coreExecutor._help();
+    }
+
+    FutureState<T> *_s;
+};
+
+template<typename F>
+auto CoreExecutor::submit(F &&fn, Priority prio) {
+    typedef decltype(fn()) R;
+    FutureState<R> *s = new FutureState<R>;
+    if (!s) {
+        return Future<R>();
+    }
+    bool ok;
+    if constexpr(std::is_void<R>::value) {
+        ok = post([s, fn]() mutable {
+            fn();
+            __dmb();
+            s->done = true;
+            CoreExecutor::_unref(s);
+        }, prio);
+    } else {
+        ok = post([s, fn]() mutable {
+            s->value = fn();
+            __dmb();
+            s->done = true;
+            CoreExecutor::_unref(s);
+        }, prio);
+    }
+    if (!ok) {
+        delete s;
+        return Future<R>();
+    }
+    return Future<R>(s);
+}
@@ -29,8 +29,12 @@ CoreMutex::CoreMutex(mutex_t *mutex, uint8_t option) {
     _acquired = false;
     _option = option;
     _pxHigherPriorityTaskWoken = 0; // pdFALSE
+    _fm = nullptr;
     if (__isFreeRTOS) {
         auto m = __get_freertos_mutex_for_ptr(mutex);
+        if (!m) {
+            return;
+        }
 
         if (__freertos_check_if_in_isr()) {
             if (!__freertos_mutex_take_from_isr(m, &_pxHigherPriorityTaskWoken)) {
@@ -41,6 +45,7 @@ CoreMutex::CoreMutex(mutex_t *mutex, uint8_t option) {
             // Grab the mutex normally, possibly waking other tasks to get it
             __freertos_mutex_take(m);
         }
+        _fm = m; // Saves a 2nd lookup on release
     } else {
         uint32_t owner;
         if (!mutex_try_enter(_mutex, &owner)) {
@@ -59,7 +64,7 @@ CoreMutex::CoreMutex(mutex_t *mutex, uint8_t option) {
 CoreMutex::~CoreMutex() {
     if (_acquired) {
         if (__isFreeRTOS) {
-            auto m = __get_freertos_mutex_for_ptr(_mutex);
+            auto m = _fm;
             if (__freertos_check_if_in_isr()) {
                 __freertos_mutex_give_from_isr(m, &_pxHigherPriorityTaskWoken);
             } else {
@@ -44,4 +44,5 @@ private:
     bool _acquired;
     uint8_t _option;
     BaseType_t _pxHigherPriorityTaskWoken;
+    SemaphoreHandle_t _fm;
 };
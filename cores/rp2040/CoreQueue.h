@@ -0,0 +1,303 @@
+/*
+    Lock-free inter-core message queues for the Raspberry Pi Pico RP2040
+
+    SPSCQueue<T, N> - exactly 1 producer and 1 consumer (e.g. core 0 -> core 1)
+    MPMCQueue<T, N> - any number of producers and consumers, on either core
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/sync.h>
+#include <pico/time.h>
+#include <type_traits>
+#include "_freertos.h"
+
+// Blocked readers and writers sleep in WFE and every push/pop does a SEV, so
+// waiting costs no bus bandwidth and wakes within a few cycles.  Under FreeRTOS
+// the waiting task yields instead so other tasks on that core keep running.
+class CoreQueueWait {
+protected:
+    static void wait() {
+        if (__isFreeRTOS && !__freertos_check_if_in_isr()) {
+            yield();
+        } else {
+            __wfe();
+        }
+    }
+
+    // Returns false once the deadline has passed
+    static bool wait(absolute_time_t until) {
+        if (__isFreeRTOS && !__freertos_check_if_in_isr()) {
+            yield();
+            return !time_reached(until);
+        }
+        return !best_effort_wfe_or_timeout(until);
+    }
+
+    static void wake() {
+        __sev();
+    }
+};
+
+// Single producer, single consumer.  No locks at all, so push_nb/pop_nb and the
+// reserve/commit and peek/release pairs are safe from IRQs as long as each end
+// is only ever used from 1 place at a time.
+template<typename T, size_t N>
+class SPSCQueue : private CoreQueueWait {
+    static_assert(N && !(N & (N - 1)), "SPSCQueue size must be a power of 2");
+    static_assert(std::is_trivially_copyable<T>::value, "SPSCQueue can only hold trivially copyable types");
+
+public:
+    SPSCQueue() : _head(0), _tail(0) { /* noop */ }
+
+    bool push_nb(const T &val) {
+        T *slot = reserve();
+        if (!slot) {
+            return false;
+        }
+        *slot = val;
+        commit();
+        return true;
+    }
+
+    void push(const T &val) {
+        while (!push_nb(val)) {
+            wait();
+        }
+    }
+
+    bool push(const T &val, uint32_t timeoutMs) {
+        absolute_time_t until = make_timeout_time_ms(timeoutMs);
+        while (!push_nb(val)) {
+            if (!wait(until)) {
+                return push_nb(val);
+            }
+        }
+        return true;
+    }
+
+    bool pop_nb(T *val) {
+        const T *slot = peek();
+        if (!slot) {
+            return false;
+        }
+        *val = *slot;
+        release();
+        return true;
+    }
+
+    T pop() {
+        T val;
+        while (!pop_nb(&val)) {
+            wait();
+        }
+        return val;
+    }
+
+    bool pop(T *val, uint32_t timeoutMs) {
+        absolute_time_t until = make_timeout_time_ms(timeoutMs);
+        while (!pop_nb(val)) {
+            if (!wait(until)) {
+                return pop_nb(val);
+            }
+        }
+        return true;
+    }
+
+    // Zero-copy producer side:  fill in the returned slot and then commit() it.  nullptr when full
+    T *reserve() {
+        if (_tail - _head == N) {
+            return nullptr;
+        }
+        return &_buf[_tail & (N - 1)];
+    }
+
+    void commit() {
+        __dmb(); // Slot contents must be visible before the index moves
+        _tail = _tail + 1;
+        wake();
+    }
+
+    // Zero-copy consumer side:  use the returned slot and then release() it.  nullptr when empty
+    T *peek() {
+        if (_head == _tail) {
+            return nullptr;
+        }
+        __dmb();
+        return &_buf[_head & (N - 1)];
+    }
+
+    void release() {
+        __dmb(); // Done reading the slot before it can be reused
+        _head = _head + 1;
+        wake();
+    }
+
+    size_t available() {
+        return _tail - _head;
+    }
+
+    size_t availableForWrite() {
+        return N - available();
+    }
+
+private:
+    volatile uint32_t _head; // Only written by the consumer
+    volatile uint32_t _tail; // Only written by the producer
+    T _buf[N];
+};
+
+// Multiple producers and consumers.  Each slot carries a sequence number which
+// says whether it is free, filled, or in use.  The M0+ has no atomic compare-and-swap,
+// so claiming a position is done under a hardware spinlock held for only a few
+// instructions, while copying data in and out happens outside of it.  Safe from
+// IRQs and both cores.
+template<typename T, size_t N>
+class MPMCQueue : private CoreQueueWait {
+    static_assert(N && !(N & (N - 1)), "MPMCQueue size must be a power of 2");
+    static_assert(std::is_trivially_copyable<T>::value, "MPMCQueue can only hold trivially copyable types");
+
+public:
+    MPMCQueue() : _head(0), _tail(0) {
+        for (size_t i = 0; i < N; i++) {
+            _slot[i].seq = i;
+        }
+        _lock = spin_lock_init(spin_lock_claim_unused(true));
+    }
+
+    ~MPMCQueue() {
+        spin_lock_unclaim(spin_lock_get_num(_lock));
+    }
+
+    bool push_nb(const T &val) {
+        T *slot = reserve();
+        if (!slot) {
+            return false;
+        }
+        *slot = val;
+        commit(slot);
+        return true;
+    }
+
+    void push(const T &val) {
+        while (!push_nb(val)) {
+            wait();
+        }
+    }
+
+    bool push(const T &val, uint32_t timeoutMs) {
+        absolute_time_t until = make_timeout_time_ms(timeoutMs);
+        while (!push_nb(val)) {
+            if (!wait(until)) {
+                return push_nb(val);
+            }
+        }
+        return true;
+    }
+
+    bool pop_nb(T *val) {
+        const T *slot = acquire();
+        if (!slot) {
+            return false;
+        }
+        *val = *slot;
+        release(slot);
+        return true;
+    }
+
+    T pop() {
+        T val;
+        while (!pop_nb(&val)) {
+            wait();
+        }
+        return val;
+    }
+
+    bool pop(T *val, uint32_t timeoutMs) {
+        absolute_time_t until = make_timeout_time_ms(timeoutMs);
+        while (!pop_nb(val)) {
+            if (!wait(until)) {
+                return pop_nb(val);
+            }
+        }
+        return true;
+    }
+
+    // Zero-copy producer side:  fill in the returned slot and then commit() it.  nullptr when full.
+    // Other producers can keep going while this slot is being filled
+    T *reserve() {
+        uint32_t save = spin_lock_blocking(_lock);
+        Slot *s = &_slot[_tail & (N - 1)];
+        if (s->seq != _tail) {
+            spin_unlock(_lock, save);
+            return nullptr; // Still owned by a consumer
+        }
+        _tail = _tail + 1;
+        spin_unlock(_lock, save);
+        return &s->data;
+    }
+
+    void commit(T *data) {
+        Slot *s = _toSlot(data);
+        __dmb();
+        s->seq = s->seq + 1; // Filled, position + 1
+        wake();
+    }
+
+    // Zero-copy consumer side:  use the returned slot and then release() it.  nullptr when empty
+    const T *acquire() {
+        uint32_t save = spin_lock_blocking(_lock);
+        Slot *s = &_slot[_head & (N - 1)];
+        if (s->seq != _head + 1) {
+            spin_unlock(_lock, save);
+            return nullptr; // Empty, or the producer hasn't committed yet
+        }
+        _head = _head + 1;
+        spin_unlock(_lock, save);
+        __dmb();
+        return &s->data;
+    }
+
+    void release(const T *data) {
+        Slot *s = _toSlot(data);
+        __dmb();
+        s->seq = s->seq - 1 + N; // Free again, for the position 1 lap later
+        wake();
+    }
+
+    size_t available() {
+        return _tail - _head;
+    }
+
+private:
+    typedef struct {
+        volatile uint32_t seq;
+        T data;
+    } Slot;
+
+    Slot *_toSlot(const T *data) {
+        return (Slot *)((const uint8_t *)data - offsetof(Slot, data));
+    }
+
+    spin_lock_t *_lock;
+    volatile uint32_t _head;
+    volatile uint32_t _tail;
+    Slot _slot[N];
+};
@@ -0,0 +1,148 @@
+/*
+    Low-overhead binary event tracing for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CoreTrace.h"
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+
+// Each core only ever adds to its own ring, and only dump() removes from them,
+// so the only protection needed is against IRQs on the same core.
+typedef struct {
+    CoreTrace::Record *buf;
+    uint32_t mask;
+    volatile uint32_t head; // Only written by dump()
+    volatile uint32_t tail; // Only written by the owning core
+    volatile uint32_t dropped;
+    uint32_t reported;
+} TraceRing;
+
+static TraceRing _ring[2];
+
+// Stream format: chunks of an 8 byte header ("RPTR", version, count) and then count Records
+static const uint16_t TRACE_VERSION = 1;
+
+extern "C" void __not_in_flash_func(__core_trace_record)(uint16_t id, uint8_t kind, uint32_t a, uint32_t b) {
+    uint32_t core = get_core_num();
+    TraceRing *r = &_ring[core];
+    if (!r->buf) {
+        return;
+    }
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t t = r->tail;
+    if (t - r->head > r->mask) {
+        r->dropped = r->dropped + 1;
+    } else {
+        CoreTrace::Record *rec = &r->buf[t & r->mask];
+        rec->us = timer_hw->timerawl;
+        rec->id = id;
+        rec->kind = kind;
+        rec->core = core;
+        rec->a = a;
+        rec->b = b;
+        __dmb(); // Record must be complete before dump() can see it
+        r->tail = t + 1;
+    }
+    restore_interrupts(save);
+}
+
+bool CoreTrace::begin(size_t recordsPerCore) {
+    if (_ring[0].buf) {
+        DEBUGCORE("ERROR: CoreTrace already running\n");
+        return false;
+    }
+    size_t n = 16;
+    while (n < recordsPerCore) {
+        n <<= 1;
+    }
+    Record *b0 = (Record *)malloc(n * sizeof(Record));
+    Record *b1 = (Record *)malloc(n * sizeof(Record));
+    if (!b0 || !b1) {
+        DEBUGCORE("ERROR: CoreTrace unable to allocate buffers\n");
+        free(b0);
+        free(b1);
+        return false;
+    }
+    Record *b[2] = { b0, b1 };
+    for (int i = 0; i < 2; i++) {
+        _ring[i].mask = n - 1;
+        _ring[i].head = 0;
+        _ring[i].tail = 0;
+        _ring[i].dropped = 0;
+        _ring[i].reported = 0;
+        __dmb();
+        _ring[i].buf = b[i];
+    }
+    return true;
+}
+
+void CoreTrace::end() {
+    for (int i = 0; i < 2; i++) {
+        Record *b = _ring[i].buf;
+        _ring[i].buf = nullptr;
+        __dmb();
+        free(b);
+    }
+}
+
+static void _writeChunk(Print &p, const CoreTrace::Record *rec, uint16_t count) {
+    uint8_t hdr[8] = { 'R', 'P', 'T', 'R', TRACE_VERSION & 0xff, TRACE_VERSION >> 8, (uint8_t)(count & 0xff), (uint8_t)(count >> 8) };
+    p.write(hdr, sizeof(hdr));
+    p.write((const uint8_t *)rec, count * sizeof(CoreTrace::Record));
+}
+
+size_t CoreTrace::dump(Print &p) {
+    Record chunk[32];
+    size_t total = 0;
+    for (int core = 0; core < 2; core++) {
+        TraceRing *r = &_ring[core];
+        if (!r->buf) {
+            continue;
+        }
+        uint32_t lost = r->dropped - r->reported;
+        if (lost) {
+            r->reported += lost;
+            chunk[0] = { time_us_32(), CORE_TRACE_DROPPED, CORE_TRACE_INSTANT, (uint8_t)core, lost, 0 };
+            _writeChunk(p, chunk, 1);
+        }
+        // Stop at what's there now, so a busy core can't keep us here forever
+        uint32_t stop = r->tail;
+        while (true) {
+            // Copy out and free the slots before writing, which may block for a while
+            uint32_t h = r->head;
+            uint32_t n = min((uint32_t)(stop - h), (uint32_t)(sizeof(chunk) / sizeof(chunk[0])));
+            if (!n) {
+                break;
+            }
+            __dmb();
+            for (uint32_t i = 0; i < n; i++) {
+                chunk[i] = r->buf[(h + i) & r->mask];
+            }
+            __dmb();
+            r->head = h + n;
+            _writeChunk(p, chunk, n);
+            total += n;
+        }
+    }
+    return total;
+}
+
+uint32_t CoreTrace::dropped() {
+    return _ring[0].dropped + _ring[1].dropped;
+}
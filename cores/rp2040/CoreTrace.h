@@ -0,0 +1,92 @@
+/*
+    Low-overhead binary event tracing for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    Trace points only exist when building with -DDEBUG_RP2040_TRACE, otherwise
+    they compile to nothing.  Each one stores a 16-byte record (microsecond
+    timestamp, event ID, 2 32-bit arguments) in a per-core ring buffer, so
+    recording never waits on the other core and never does any I/O.
+    CoreTrace::dump() drains the buffers to any Print (Serial, a File...) and
+    tools/tracedecode.py turns the result into Chrome trace JSON for
+    chrome://tracing or ui.perfetto.dev.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Event IDs below CORE_TRACE_USER are reserved for the core and its libraries
+enum {
+    CORE_TRACE_DROPPED = 0,     // Added by dump(), a = records lost since the last dump
+    CORE_TRACE_LWIP_WAIT,       // Waiting for the lwIP lock
+    CORE_TRACE_LWIP_LOCK,       // Holding the lwIP lock
+    CORE_TRACE_TCP_WRITE,       // a = ClientContext, b = bytes
+    CORE_TRACE_TCP_RECV,        // a = ClientContext, b = bytes
+    CORE_TRACE_TCP_ACKED,       // a = ClientContext, b = bytes
+    CORE_TRACE_AUDIO_IRQ,       // a = DMA channel, b = 1 on underflow/overflow
+    CORE_TRACE_FLASH_COMMIT,    // a = operations, b = microseconds (on the end record)
+    CORE_TRACE_USER = 0x1000
+};
+
+enum {
+    CORE_TRACE_INSTANT = 0,
+    CORE_TRACE_BEGIN,
+    CORE_TRACE_END,
+    CORE_TRACE_COUNTER
+};
+
+extern "C" void __core_trace_record(uint16_t id, uint8_t kind, uint32_t a, uint32_t b);
+
+#ifdef DEBUG_RP2040_TRACE
+#define CORE_TRACE(id, a, b) __core_trace_record(id, CORE_TRACE_INSTANT, (uint32_t)(a), (uint32_t)(b))
+#define CORE_TRACE_BEGIN(id, a, b) __core_trace_record(id, CORE_TRACE_BEGIN, (uint32_t)(a), (uint32_t)(b))
+#define CORE_TRACE_END(id, a, b) __core_trace_record(id, CORE_TRACE_END, (uint32_t)(a), (uint32_t)(b))
+#define CORE_TRACE_COUNTER(id, val) __core_trace_record(id, CORE_TRACE_COUNTER, (uint32_t)(val), 0)
+#else
+#define CORE_TRACE(id, a, b) do { } while (0)
+#define CORE_TRACE_BEGIN(id, a, b) do { } while (0)
+#define CORE_TRACE_END(id, a, b) do { } while (0)
+#define CORE_TRACE_COUNTER(id, val) do { } while (0)
+#endif
+
+class CoreTrace {
+public:
+    typedef struct {
+        uint32_t us;
+        uint16_t id;
+        uint8_t kind;
+        uint8_t core;
+        uint32_t a;
+        uint32_t b;
+    } Record;
+
+    // Allocates the buffers, rounded up to a power of 2.  Nothing is recorded before this
+    static bool begin(size_t recordsPerCore = 512);
+
+    // Only call once no trace points can run
+    static void end();
+
+    // Writes out and frees everything recorded so far, returns the number of records.
+    // Call periodically to stream, only from 1 place at a time
+    static size_t dump(Print &p);
+
+    // Records lost because a buffer was full
+    static uint32_t dropped();
+};
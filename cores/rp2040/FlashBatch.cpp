@@ -0,0 +1,106 @@
+/*
+    Batched flash erase/program with a single other-core park window
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "FlashBatch.h"
+#include "CoreTrace.h"
+#include <hardware/flash.h>
+#include <hardware/timer.h>
+
+static FlashBatch::Stats _stats = { 0, 0, 0, 0 };
+
+bool FlashBatch::add(uint32_t offset, const uint8_t *data, size_t len) {
+    if (!len) {
+        return true;
+    }
+    // Merge with the last operation when it continues it exactly
+    if (_ops) {
+        Op *last = &_op[_ops - 1];
+        if (((last->data == nullptr) == (data == nullptr)) && (last->offset + last->len == offset) &&
+                (!data || (last->data + last->len == data))) {
+            last->len += len;
+            return true;
+        }
+    }
+    if (_ops == MAX_OPS) {
+        commit();
+    }
+    _op[_ops].offset = offset;
+    _op[_ops].data = data;
+    _op[_ops].len = len;
+    _ops++;
+    return true;
+}
+
+bool FlashBatch::erase(uint32_t offset, size_t len) {
+    if ((offset & (FLASH_SECTOR_SIZE - 1)) || (len & (FLASH_SECTOR_SIZE - 1))) {
+        DEBUGCORE("ERROR: FlashBatch::erase unaligned (0x%08lx, %u)\n", offset, (unsigned)len);
+        return false;
+    }
+    return add(offset, nullptr, len);
+}
+
+bool FlashBatch::program(uint32_t offset, const void *data, size_t len) {
+    if ((offset & (FLASH_PAGE_SIZE - 1)) || (len & (FLASH_PAGE_SIZE - 1)) || !data) {
+        DEBUGCORE("ERROR: FlashBatch::program unaligned (0x%08lx, %u)\n", offset, (unsigned)len);
+        return false;
+    }
+    return add(offset, (const uint8_t *)data, len);
+}
+
+void FlashBatch::commit() {
+    if (!_ops) {
+        return;
+    }
+    CORE_TRACE_BEGIN(CORE_TRACE_FLASH_COMMIT, _ops, 0);
+    noInterrupts();
+    uint32_t start = time_us_32();
+    rp2040.idleOtherCore();
+    for (int i = 0; i < _ops; i++) {
+        if (_op[i].data) {
+            flash_range_program(_op[i].offset, _op[i].data, _op[i].len);
+        } else {
+            // The SDK uses 64KB block erases for any aligned 64KB pieces
+            flash_range_erase(_op[i].offset, _op[i].len);
+        }
+    }
+    rp2040.resumeOtherCore();
+    uint32_t us = time_us_32() - start;
+    interrupts();
+    CORE_TRACE_END(CORE_TRACE_FLASH_COMMIT, _ops, us);
+    _ops = 0;
+
+    _stats.count++;
+    _stats.lastUs = us;
+    _stats.maxUs = max(_stats.maxUs, us);
+    _stats.totalUs += us;
+}
+
+FlashBatch::Stats FlashBatch::stats() {
+    noInterrupts();
+    Stats s = _stats;
+    interrupts();
+    return s;
+}
+
+void FlashBatch::resetStats() {
+    noInterrupts();
+    memset(&_stats, 0, sizeof(_stats));
+    interrupts();
+}
@@ -0,0 +1,89 @@
+/*
+    Batched flash erase/program with a single other-core park window
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Flash can't be read while it's being written, so the other core has to be
+// parked and interrupts disabled for the whole operation.  Queuing several
+// erases and programs in a FlashBatch does them all in 1 park window instead
+// of 1 per operation, and contiguous erases are merged so the flash can use
+// its faster 64KB block erase.  The time the other core spent parked is
+// recorded, see FlashBatch::stats().
+//
+// Offsets are from the start of flash (not XIP_BASE).  Erases must be 4KB
+// aligned and programs 256-byte aligned, and program data must stay valid
+// until commit().
+class FlashBatch {
+public:
+    static constexpr int MAX_OPS = 16;
+
+    typedef struct {
+        uint32_t count;   // Number of park windows
+        uint32_t lastUs;  // Length of the most recent one
+        uint32_t maxUs;   // Longest one seen
+        uint64_t totalUs;
+    } Stats;
+
+    FlashBatch() : _ops(0) { /* noop */ }
+    ~FlashBatch() {
+        commit();
+    }
+
+    bool erase(uint32_t offset, size_t len);
+    bool program(uint32_t offset, const void *data, size_t len);
+
+    // Performs everything queued, returning once flash is readable again
+    void commit();
+
+    // Drops everything queued without touching flash, e.g. when a later
+    // operation of a read-modify-write was rejected
+    void clear() {
+        _ops = 0;
+    }
+
+    // Single operations, for when there's nothing to batch.  Return false
+    // if the operation was rejected and nothing was written
+    static bool eraseNow(uint32_t offset, size_t len) {
+        FlashBatch b;
+        return b.erase(offset, len);
+    }
+
+    static bool programNow(uint32_t offset, const void *data, size_t len) {
+        FlashBatch b;
+        return b.program(offset, data, len);
+    }
+
+    static Stats stats();
+    static void resetStats();
+
+private:
+    typedef struct {
+        uint32_t offset;
+        const uint8_t *data; // nullptr for an erase
+        size_t len;
+    } Op;
+
+    bool add(uint32_t offset, const uint8_t *data, size_t len);
+
+    Op _op[MAX_OPS];
+    int _ops;
+};
@@ -0,0 +1,77 @@
+/*
+    Heap usage, fragmentation and allocation-site statistics
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    The malloc/calloc/realloc/free wrappers keep per-core counters of the bytes
+    in use, the peak, and how many blocks of each size have been allocated.
+    Define "size_t heap_stats_callers = 64;" in the sketch to also count
+    allocations by calling address, to find what is churning the heap:
+
+        HeapStats::report(Serial);
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class HeapStats {
+public:
+    // Block sizes up to 16, 32, 64...4096 bytes, and larger
+    static constexpr int BUCKETS = 10;
+
+    typedef struct {
+        uint32_t allocs;        // Total since boot
+        int32_t live;           // Currently allocated
+    } Bucket;
+
+    typedef struct {
+        uint32_t pc;            // Address the allocator was called from
+        uint32_t allocs;
+        uint32_t bytes;
+    } Site;
+
+    // Bytes currently allocated, including rounding up by the allocator
+    static size_t used();
+
+    // Most bytes ever allocated at once.  Approximate if both cores allocate at the same instant
+    static size_t peak();
+    static void resetPeak();
+
+    // Allocations which returned nullptr
+    static uint32_t failed();
+
+    // Largest block in each bucket, and its counters
+    static size_t bucketSize(int b);
+    static Bucket bucket(int b);
+
+    // Largest single block malloc() could return right now.  Takes the heap lock for a few dozen trial allocations
+    static size_t maxFreeBlock();
+
+    // 0 when all the free heap is in 1 block, approaching 100 as it is split into smaller pieces
+    static int fragmentation();
+
+    // Up to n call sites, busiest first.  Returns the number filled in
+    static int sites(Site *s, int n);
+    static void resetSites();
+
+    // Human-readable summary.  Feed the call site addresses to
+    // arm-none-eabi-addr2line -f -e sketch.elf to get function names
+    static void report(Print &p, int topSites = 10);
+};
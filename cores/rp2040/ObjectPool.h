@@ -0,0 +1,151 @@
+/*
+    Fixed-size, IRQ and multicore safe object pools
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/sync.h>
+#include <new>
+#include <utility>
+
+// N preallocated blocks of sizeof(T), with O(1) alloc/free under a striped
+// hardware spinlock so they may be used from IRQs and both cores.  No
+// constructor work is needed, so a global pool is usable at any time during
+// startup and never touches the heap.
+template<typename T, size_t N>
+class ObjectPool {
+public:
+    typedef struct {
+        size_t capacity;
+        size_t inUse;
+        size_t peak;      // Most blocks ever in use at once
+        uint32_t misses;  // Allocations which found the pool empty
+    } Stats;
+
+    constexpr ObjectPool() { /* noop */ }
+
+    // Raw block of sizeof(T), or nullptr when the pool is empty
+    void *alloc() {
+        uint32_t save = spin_lock_blocking(_lock());
+        Block *b = _free;
+        if (b) {
+            _free = b->next;
+        } else if (_unused < N) {
+            b = &_block[_unused++];
+        }
+        if (b) {
+            _inUse++;
+            _peak = max(_peak, _inUse);
+        } else {
+            _misses++;
+        }
+        spin_unlock(_lock(), save);
+        return b;
+    }
+
+    // Returns false if p didn't come from this pool (and so was not freed)
+    bool free(void *p) {
+        if (!owns(p)) {
+            return false;
+        }
+        Block *b = (Block *)p;
+        uint32_t save = spin_lock_blocking(_lock());
+        b->next = _free;
+        _free = b;
+        _inUse--;
+        spin_unlock(_lock(), save);
+        return true;
+    }
+
+    template<typename... Args>
+    T *create(Args&&... args) {
+        void *p = alloc();
+        return p ? new (p) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    void destroy(T *obj) {
+        if (obj) {
+            obj->~T();
+            free(obj);
+        }
+    }
+
+    bool owns(const void *p) const {
+        return ((const uint8_t *)p >= (const uint8_t *)&_block[0]) && ((const uint8_t *)p < (const uint8_t *)&_block[N]);
+    }
+
+    Stats stats() {
+        uint32_t save = spin_lock_blocking(_lock());
+        Stats s = { N, _inUse, _peak, _misses };
+        spin_unlock(_lock(), save);
+        return s;
+    }
+
+private:
+    typedef union Block {
+        union Block *next;
+        alignas(T) uint8_t data[sizeof(T)];
+    } Block;
+
+    // Shared striped locks are only held for a few instructions, pick one by address to spread pools out
+    spin_lock_t *_lock() const {
+        return spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST +
+                                  (((uintptr_t)this >> 4) % (PICO_SPINLOCK_ID_STRIPED_LAST - PICO_SPINLOCK_ID_STRIPED_FIRST + 1)));
+    }
+
+    Block _block[N] = {};
+    Block *_free = nullptr;
+    size_t _unused = 0; // Blocks past here have never been handed out, so there's no list to build at startup
+    size_t _inUse = 0;
+    size_t _peak = 0;
+    uint32_t _misses = 0;
+};
+
+// Inherit from this to have "new T" and "delete" use a pool of N objects, falling
+// back to the heap when the pool is empty (or for larger derived classes).
+// N == 0 leaves the class on the normal heap, so pooling can be a build option.
+template<typename T, size_t N>
+class PoolAllocated {
+public:
+    static void *operator new(size_t size) {
+        void *p = (size == sizeof(T)) ? _pool.alloc() : nullptr;
+        return p ? p : ::operator new(size);
+    }
+
+    static void operator delete(void *p) {
+        if (p && !_pool.free(p)) {
+            ::operator delete(p);
+        }
+    }
+
+    static typename ObjectPool<T, N>::Stats poolStats() {
+        return _pool.stats();
+    }
+
+private:
+    static ObjectPool<T, N> _pool;
+};
+
+template<typename T, size_t N>
+ObjectPool<T, N> PoolAllocated<T, N>::_pool;
+
+template<typename T>
+class PoolAllocated<T, 0> {
+};
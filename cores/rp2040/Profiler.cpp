@@ -0,0 +1,283 @@
+/*
+    Lightweight IRQ and PC-sampling profiler for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Profiler.h"
+#include <hardware/irq.h>
+#include <hardware/timer.h>
+#include <hardware/structs/systick.h>
+#include "_freertos.h"
+
+extern "C" void __unhandled_user_irq();
+
+Profiler profiler;
+
+// Original handlers, indexed by IRQ.  The vector table is shared by both cores
+static irq_handler_t _orig[32];
+static irq_handler_t _origSample;
+
+// Swap vector table entries directly, the SDK calls refuse to replace an existing handler
+static void _setVector(int irq, irq_handler_t h) {
+    irq_get_vtable()[VTABLE_FIRST_IRQ + irq] = h;
+    __dmb();
+}
+
+static const char *_irqName[32] = {
+    "TIMER_0", "TIMER_1", "TIMER_2", "TIMER_3", "PWM_WRAP", "USBCTRL", "XIP", "PIO0_0",
+    "PIO0_1", "PIO1_0", "PIO1_1", "DMA_0", "DMA_1", "IO_BANK0", "IO_QSPI", "SIO_PROC0",
+    "SIO_PROC1", "CLOCKS", "SPI0", "SPI1", "UART0", "UART1", "ADC_FIFO", "I2C0",
+    "I2C1", "RTC", "SW_26", "SW_27", "SW_28", "SW_29", "SW_30", "SW_31"
+};
+
+// On bare metal each core has its own free-running 24-bit SysTick, which is
+// all we need for IRQ-length intervals.  FreeRTOS owns SysTick, so use the
+// cycle counter it sets up instead.
+static inline uint32_t __not_in_flash_func(_now)() {
+    if (__isFreeRTOS) {
+        return rp2040.getCycleCount();
+    }
+    return 0xffffff - systick_hw->cvr;
+}
+
+// SysTick is per-core and only running if something on this core started it, so
+// the first IRQ timed on a core (e.g. core 1 when begin() ran on core 0) starts it
+static inline void __not_in_flash_func(_startSysTick)() {
+    if (!__isFreeRTOS && !(systick_hw->csr & 1)) {
+        systick_hw->rvr = 0xffffff;
+        systick_hw->cvr = 0;
+        systick_hw->csr = 0x5; // Enable, CPU clock, no IRQ
+    }
+}
+
+static inline uint32_t __not_in_flash_func(_delta)(uint32_t start) {
+    return (_now() - start) & (__isFreeRTOS ? 0xffffffff : 0xffffff);
+}
+
+static void __not_in_flash_func(_irqWrapper)() {
+    int irq = __get_current_exception() - VTABLE_FIRST_IRQ;
+    _startSysTick();
+    uint32_t start = _now();
+    irq_handler_t h = _orig[irq];
+    if (!h) {
+        return;
+    }
+    h();
+    profiler._irqDone(get_core_num(), irq, _delta(start));
+}
+
+// The timer IRQ needs the PC stacked on exception entry, so find the stack
+// frame before any C code can push more onto it.  Bit 2 of EXC_RETURN says
+// whether the interrupted code was running on the process (FreeRTOS task) or
+// main stack.
+extern "C" void __not_in_flash_func(_profilerSample)(uint32_t excReturn, uint32_t *msp) {
+    uint32_t *frame = msp;
+    if (excReturn & 4) {
+        asm volatile("mrs %0, psp" : "=r"(frame));
+    }
+    profiler._sample(frame[6]);
+}
+
+static int _sampleAlarm = -1;
+static uint32_t _samplePeriodUs;
+
+static void __attribute__((naked)) __not_in_flash_func(_sampleIRQ)() {
+    asm volatile(
+        "mov r0, lr\n"
+        "mov r1, sp\n"
+        "push {r0, lr}\n"
+        "bl _profilerSample\n"
+        "pop {r0, pc}\n"
+    );
+}
+
+Profiler::Profiler() {
+    _wrapped = false;
+    _alarm = -1;
+    reset();
+}
+
+void Profiler::begin() {
+    _startSysTick();
+    if (_wrapped) {
+        return;
+    }
+    uint32_t save = save_and_disable_interrupts();
+    for (int i = 0; i < 32; i++) {
+        irq_handler_t h = irq_get_vtable_handler(i);
+        if ((h == __unhandled_user_irq) || (h == _sampleIRQ) || (h == _irqWrapper)) {
+            _orig[i] = nullptr;
+            continue;
+        }
+        _orig[i] = h;
+        _setVector(i, _irqWrapper);
+    }
+    _wrapped = true;
+    restore_interrupts(save);
+    reset();
+}
+
+void Profiler::end() {
+    stopSampling();
+    if (!_wrapped) {
+        return;
+    }
+    uint32_t save = save_and_disable_interrupts();
+    // The other core may have entered _irqWrapper just before its vector
+    // was restored, so _orig[] is left alone for it to finish with
+    for (int i = 0; i < 32; i++) {
+        if (_orig[i] && (irq_get_vtable_handler(i) == _irqWrapper)) {
+            _setVector(i, _orig[i]);
+        }
+    }
+    _wrapped = false;
+    restore_interrupts(save);
+}
+
+bool Profiler::startSampling(uint32_t hz) {
+    if (_alarm >= 0) {
+        DEBUGCORE("ERROR: Profiler already sampling\n");
+        return false;
+    }
+    if (!hz || (hz > 100000)) {
+        DEBUGCORE("ERROR: Profiler sample rate must be 1 to 100000Hz\n");
+        return false;
+    }
+    _alarm = hardware_alarm_claim_unused(false);
+    if (_alarm < 0) {
+        DEBUGCORE("ERROR: Profiler unable to claim a timer alarm\n");
+        return false;
+    }
+    _sampleAlarm = _alarm;
+    _samplePeriodUs = 1000000 / hz;
+    _origSample = irq_get_vtable_handler(TIMER_IRQ_0 + _alarm);
+    _setVector(TIMER_IRQ_0 + _alarm, _sampleIRQ);
+    hw_set_bits(&timer_hw->inte, 1u << _alarm);
+    irq_set_enabled(TIMER_IRQ_0 + _alarm, true);
+    timer_hw->alarm[_alarm] = timer_hw->timerawl + _samplePeriodUs;
+    return true;
+}
+
+void Profiler::stopSampling() {
+    if (_alarm < 0) {
+        return;
+    }
+    irq_set_enabled(TIMER_IRQ_0 + _alarm, false);
+    hw_clear_bits(&timer_hw->inte, 1u << _alarm);
+    timer_hw->armed = 1u << _alarm;
+    _setVector(TIMER_IRQ_0 + _alarm, _origSample);
+    hardware_alarm_unclaim(_alarm);
+    _alarm = -1;
+    _sampleAlarm = -1;
+}
+
+void Profiler::reset() {
+    uint32_t save = save_and_disable_interrupts();
+    for (int c = 0; c < 2; c++) {
+        for (int i = 0; i < 32; i++) {
+            _irq[c][i] = { 0, 0xffffffff, 0, 0 };
+        }
+    }
+    for (int i = 0; i < MAX_PCS; i++) {
+        _pc[i] = 0;
+        _pcHits[i] = 0;
+    }
+    _samples = 0;
+    _dropped = 0;
+    _startUs = time_us_64();
+    restore_interrupts(save);
+}
+
+void __not_in_flash_func(Profiler::_irqDone)(int core, int irq, uint32_t cycles) {
+    IRQStats *s = &_irq[core][irq];
+    s->calls++;
+    s->total += cycles;
+    if (cycles < s->min) {
+        s->min = cycles;
+    }
+    if (cycles > s->max) {
+        s->max = cycles;
+    }
+}
+
+void __not_in_flash_func(Profiler::_sample)(uint32_t pc) {
+    // Only 1 alarm, so this is only ever called on 1 core at a time
+    timer_hw->intr = 1u << _sampleAlarm;
+    timer_hw->alarm[_sampleAlarm] = timer_hw->timerawl + _samplePeriodUs;
+
+    _samples++;
+    pc &= ~1;
+    uint32_t h = (pc >> 1) * 2654435761u;
+    for (int i = 0; i < 8; i++) {
+        int idx = ((h >> 24) + i) & (MAX_PCS - 1);
+        if (_pc[idx] == pc) {
+            _pcHits[idx]++;
+            return;
+        } else if (!_pc[idx]) {
+            _pc[idx] = pc;
+            _pcHits[idx] = 1;
+            return;
+        }
+    }
+    _dropped++;
+}
+
+void Profiler::report(Print &p, int topPCs) {
+    uint64_t us = elapsedUs();
+    float cyclesPerUs = rp2040.f_cpu() / 1000000.0f;
+    p.printf("Profile over %lu ms\n", (uint32_t)(us / 1000));
+    p.printf("Core IRQ        Calls      Min      Avg      Max  Total %%\n");
+    for (int c = 0; c < 2; c++) {
+        uint64_t irqCycles = 0;
+        for (int i = 0; i < 32; i++) {
+            IRQStats s = _irq[c][i];
+            if (!s.calls) {
+                continue;
+            }
+            irqCycles += s.total;
+            p.printf("%-4d %-10s %6lu %8lu %8lu %8lu %6.2f\n", c, _irqName[i], s.calls, s.min,
+                     (uint32_t)(s.total / s.calls), s.max, us ? 100.0f * s.total / cyclesPerUs / us : 0.0f);
+        }
+        if (irqCycles) {
+            p.printf("%-4d %-10s %43.2f\n", c, "(not IRQ)", us ? 100.0f - 100.0f * irqCycles / cyclesPerUs / us : 100.0f);
+        }
+    }
+
+    if (!_samples) {
+        return;
+    }
+    p.printf("\n%lu PC samples (%lu not recorded), busiest:\n", _samples, _dropped);
+    // Simple selection of the top N, this is only a report
+    static bool shown[MAX_PCS];
+    for (int i = 0; i < MAX_PCS; i++) {
+        shown[i] = false;
+    }
+    for (int n = 0; n < topPCs; n++) {
+        int best = -1;
+        for (int i = 0; i < MAX_PCS; i++) {
+            if (_pc[i] && !shown[i] && ((best < 0) || (_pcHits[i] > _pcHits[best]))) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        shown[best] = true;
+        p.printf("  0x%08lx %8lu %6.2f%%\n", _pc[best], _pcHits[best], 100.0f * _pcHits[best] / _samples);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+    Lightweight IRQ and PC-sampling profiler for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    profiler.begin() wraps every IRQ handler installed at that point so each
+    call is timed, per core.  Anything not spent in an IRQ was spent in
+    loop()/loop1() (or FreeRTOS tasks).  profiler.startSampling() adds a
+    statistical flat profile by recording the interrupted PC from a timer.
+
+        profiler.begin();
+        profiler.startSampling(1000);
+        ...
+        profiler.report(Serial);
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class Profiler {
+public:
+    typedef struct {
+        uint32_t calls;
+        uint32_t min; // Cycles, including any higher priority IRQs which preempted it
+        uint32_t max;
+        uint64_t total;
+    } IRQStats;
+
+    static constexpr int MAX_PCS = 256;
+
+    Profiler();
+
+    // Install the timing wrappers.  IRQ handlers added after this are not timed,
+    // and end() must be called before adding or removing IRQ handlers
+    void begin();
+    void end();
+
+    // Sample the PC of the calling core hz times per second
+    bool startSampling(uint32_t hz = 1000);
+    void stopSampling();
+
+    // Clear all counters and restart the measurement period
+    void reset();
+
+    // Raw data, for custom reports
+    const IRQStats &irq(int core, int irq) {
+        return _irq[core][irq];
+    }
+    uint64_t elapsedUs() {
+        return time_us_64() - _startUs;
+    }
+
+    // Per-IRQ table and the busiest sampled PCs.  Feed the PCs to
+    // arm-none-eabi-addr2line -f -e sketch.elf to get function names
+    void report(Print &p, int topPCs = 16);
+
+    // Internal, called from the wrappers
+    void _irqDone(int core, int irq, uint32_t cycles);
+    void _sample(uint32_t pc);
+
+private:
+    IRQStats _irq[2][32];
+    uint32_t _pc[MAX_PCS];
+    uint32_t _pcHits[MAX_PCS];
+    uint32_t _samples;
+    uint32_t _dropped;
+    uint64_t _startUs;
+    bool _wrapped;
+    int _alarm;
+};
+
+extern Profiler profiler;
@@ -20,6 +20,11 @@
 
 #include <Arduino.h>
 #include <hardware/structs/psm.h>
+#include <hardware/structs/systick.h>
+#include <hardware/structs/mpu.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include "HeapStats.h"
 
 extern "C" void boot_double_tap_check();
 
@@ -31,3 +36,152 @@ void RP2040::enableDoubleResetBootloader() {
         boot_double_tap_check();
     }
 }
+
+// Per-core state for getCycleCount64(), only ever touched by its own core with IRQs off
+typedef struct {
+    uint64_t cycles; // Value returned by the last read
+    uint64_t us;     // Timer at the last read
+    uint32_t sys;    // SysTick CVR at the last read
+    uint32_t period; // SysTick RVR + 1, or 0 if not calibrated yet
+} CycleState;
+
+static CycleState _cycleState[2];
+static uint32_t _cyclesPerUs16 = ((uint64_t)F_CPU << 16) / 1000000; // 16.16 fixed point, set from clk_sys by begin()
+
+// time_us_64() lives in flash, so read the raw (non-latching, safe from both cores) registers here
+static inline uint64_t __not_in_flash_func(_timeUs64)() {
+    uint32_t hi = timer_hw->timerawh;
+    uint32_t lo;
+    while (true) {
+        lo = timer_hw->timerawl;
+        uint32_t next = timer_hw->timerawh;
+        if (hi == next) {
+            break;
+        }
+        hi = next;
+    }
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t __not_in_flash_func(_usToCycles)(uint64_t us) {
+    // Split so this can't overflow even after years of uptime
+    return (us >> 16) * _cyclesPerUs16 + (((us & 0xffff) * _cyclesPerUs16) >> 16);
+}
+
+void RP2040::_resetCycleCount() {
+    uint32_t save = save_and_disable_interrupts();
+    _cyclesPerUs16 = ((uint64_t)clock_get_hz(clk_sys) << 16) / 1000000;
+    _cycleState[0].period = 0;
+    _cycleState[1].period = 0;
+    restore_interrupts(save);
+}
+
+uint64_t __not_in_flash_func(RP2040::getCycleCount64)() {
+    uint32_t save = save_and_disable_interrupts();
+    CycleState *s = &_cycleState[get_core_num()];
+    if (!(systick_hw->csr & 1)) {
+        // Nothing has started this core's SysTick yet (FreeRTOS does so itself), so let it free-run
+        systick_hw->rvr = 0xffffff;
+        systick_hw->cvr = 0;
+        systick_hw->csr = 0x5; // Enable, CPU clock, no IRQ
+    }
+    uint32_t sys = systick_hw->cvr;
+    uint64_t us = _timeUs64();
+    uint32_t period = systick_hw->rvr + 1;
+
+    if (period != s->period) {
+        // First read on this core, or FreeRTOS has reprogrammed SysTick.  Carry on from
+        // the microsecond timer, which both cores share, so they stay within 1us of each other
+        s->cycles = s->period ? s->cycles + _usToCycles(us - s->us) : _usToCycles(us);
+        s->period = period;
+    } else {
+        // SysTick counts down, giving the exact cycles since the last read modulo its period
+        uint64_t part = (s->sys >= sys) ? s->sys - sys : s->sys + period - sys;
+        // Only long gaps between reads need to work out how many whole periods also passed
+        uint64_t expect = _usToCycles(us - s->us);
+        if (expect > part + period / 2) {
+            uint64_t wraps = expect - part + period / 2;
+            wraps = (wraps >> 32) ? wraps / period : (uint32_t)wraps / period;
+            part += wraps * period;
+        }
+        s->cycles += part;
+    }
+    s->sys = sys;
+    s->us = us;
+    uint64_t ret = s->cycles;
+    restore_interrupts(save);
+    return ret;
+}
+
+// Stack regions, set up at boot by main()
+static constexpr uint32_t STACK_PAINT = 0xbaadf00d;
+static uint32_t *_stackBottom[2];
+static uint32_t *_stackTop[2];
+
+void RP2040::_paintStack(int core, uint32_t *bottom, uint32_t *top) {
+    bottom = (uint32_t *)(((uint32_t)bottom + 3) & ~3);
+    _stackBottom[core] = bottom;
+    _stackTop[core] = top;
+    uint32_t *end = top;
+    if (core == cpuid()) {
+        // Leave the live part of this stack, and a little slack, alone
+        end = (uint32_t *)(getStackPointer() - 64);
+    }
+    for (uint32_t *p = bottom; p < end; p++) {
+        *p = STACK_PAINT;
+    }
+}
+
+void RP2040::_guardStack() {
+    int core = cpuid();
+    if (!core_stack_guard || !_stackBottom[core]) {
+        return;
+    }
+    // The MPU's smallest region is 256 bytes, and it must be aligned to its size
+    uint32_t base = ((uint32_t)_stackBottom[core] + 255) & ~255;
+    if (base + 256 + 1024 > (uint32_t)_stackTop[core]) {
+        DEBUGCORE("ERROR: Stack on core %d too small to guard\n", core);
+        return;
+    }
+    mpu_hw->ctrl = 0;
+    mpu_hw->rnr = 7;
+    mpu_hw->rbar = base;
+    mpu_hw->rasr = M0PLUS_MPU_RASR_XN_BITS | (7 << M0PLUS_MPU_RASR_SIZE_LSB) | M0PLUS_MPU_RASR_ENABLE_BITS; // 256 bytes, no access
+    mpu_hw->ctrl = M0PLUS_MPU_CTRL_PRIVDEFENA_BITS | M0PLUS_MPU_CTRL_ENABLE_BITS;
+    __dsb();
+    __isb();
+    _stackBottom[core] = (uint32_t *)(base + 256);
+}
+
+int RP2040::getFreeStack() {
+    uint32_t *bottom = _stackBottom[cpuid()];
+    if (!bottom) {
+        return getStackPointer() - 0x20040000;
+    }
+    return getStackPointer() - (uint32_t)bottom;
+}
+
+int RP2040::getStackHighWater() {
+    int core = cpuid();
+    uint32_t *p = _stackBottom[core];
+    if (!p) {
+        return 0;
+    }
+    while ((p < _stackTop[core]) && (*p == STACK_PAINT)) {
+        p++;
+    }
+    return (uint8_t *)_stackTop[core] - (uint8_t *)p;
+}
+
+int RP2040::getStackSize() {
+    int core = cpuid();
+    return (uint8_t *)_stackTop[core] - (uint8_t *)_stackBottom[core];
+}
+
+int RP2040::getMaxFreeBlockSize() {
+    return HeapStats::maxFreeBlock();
+}
+
+int RP2040::getHeapFragmentation() {
+    return HeapStats::fragmentation();
+}
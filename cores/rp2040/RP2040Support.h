@@ -26,18 +26,19 @@
 #include <hardware/watchdog.h>
 #include <hardware/structs/rosc.h>
 #include <hardware/structs/systick.h>
+#include <hardware/structs/xip_ctrl.h>
 #include <pico/multicore.h>
 #include <pico/rand.h>
 #include <pico/util/queue.h>
 #include <pico/bootrom.h>
 #include "CoreMutex.h"
 #include "PIOProgram.h"
-#include "ccount.pio.h"
 #include <malloc.h>
 
 #include "_freertos.h"
 
 extern "C" volatile bool __otherCoreIdled;
+extern "C" void (*volatile __parkedCallback[2])();
 
 class _MFIFO {
 public:
@@ -136,8 +137,13 @@ private:
             noInterrupts(); // We need total control, can't run anything
             while (multicore_fifo_rvalid()) {
                 if (_GOTOSLEEP == multicore_fifo_pop_blocking()) {
+                    void (*cb)() = __parkedCallback[get_core_num()];
                     __otherCoreIdled = true;
-                    while (__otherCoreIdled) { /* noop */ }
+                    while (__otherCoreIdled) {
+                        if (cb) {
+                            cb();
+                        }
+                    }
                     break;
                 }
             }
@@ -161,26 +167,16 @@ extern "C" void setup1() __attribute__((weak));
 extern "C" void loop1() __attribute__((weak));
 extern "C" bool core1_separate_stack;
 extern "C" uint32_t* core1_separate_stack_address;
+extern "C" bool core_stack_guard;
 
 class RP2040 {
 public:
     RP2040()  { /* noop */ }
     ~RP2040() { /* noop */ }
 
+    // Called by main() once clk_sys is set.  Call again after changing clk_sys so getCycleCount() follows it
     void begin() {
-        _epoch = 0;
-        if (!__isFreeRTOS) {
-            // Enable SYSTICK exception
-            exception_set_exclusive_handler(SYSTICK_EXCEPTION, _SystickHandler);
-            systick_hw->csr = 0x7;
-            systick_hw->rvr = 0x00FFFFFF;
-        } else {
-            int off = 0;
-            _ccountPgm = new PIOProgram(&ccount_program);
-            _ccountPgm->prepare(&_pio, &_sm, &off);
-            ccount_program_init(_pio, _sm, off);
-            pio_sm_set_enabled(_pio, _sm, true);
-        }
+        _resetCycleCount();
     }
 
     // Convert from microseconds to PIO clock cycles
@@ -199,35 +195,14 @@ public:
         return sio_hw->cpuid;
     }
 
-    // Get CPU cycle count.  Needs to do magic to extens 24b HW to something longer
-    volatile uint64_t _epoch = 0;
+    // Get CPU cycle count.  Each core's SysTick gives the exact cycles modulo its
+    // period, and the shared 64-bit microsecond timer says how many periods went
+    // by, so this works on both cores with or without FreeRTOS
     inline uint32_t getCycleCount() {
-        if (!__isFreeRTOS) {
-            uint32_t epoch;
-            uint32_t ctr;
-            do {
-                epoch = (uint32_t)_epoch;
-                ctr = systick_hw->cvr;
-            } while (epoch != (uint32_t)_epoch);
-            return epoch + (1 << 24) - ctr; /* CTR counts down from 1<<24-1 */
-        } else {
-            return ccount_read(_pio, _sm);
-        }
+        return (uint32_t)getCycleCount64();
     }
 
-    inline uint64_t getCycleCount64() {
-        if (!__isFreeRTOS) {
-            uint64_t epoch;
-            uint64_t ctr;
-            do {
-                epoch = _epoch;
-                ctr = systick_hw->cvr;
-            } while (epoch != _epoch);
-            return epoch + (1LL << 24) - ctr;
-        } else {
-            return ccount_read(_pio, _sm);
-        }
-    }
+    uint64_t getCycleCount64();
 
     inline int getFreeHeap() {
         return getTotalHeap() - getUsedHeap();
@@ -242,23 +217,46 @@ public:
         return &__StackLimit  - &__bss_end__;
     }
 
+    // Largest single block that could be allocated right now, see HeapStats.h for more
+    int getMaxFreeBlockSize();
+
+    // 0 when the free heap is all 1 block, approaching 100 as it is split up
+    int getHeapFragmentation();
+
     inline uint32_t getStackPointer() {
         uint32_t *sp;
         asm volatile("mov %0, sp" : "=r"(sp));
         return (uint32_t)sp;
     }
 
-    inline int getFreeStack() {
-        const unsigned int sp = getStackPointer();
-        uint32_t ref = 0x20040000;
-        if (setup1 || loop1) {
-            if (core1_separate_stack) {
-                ref = cpuid() ? (unsigned int)core1_separate_stack_address : 0x20040000;
-            } else {
-                ref = cpuid() ? 0x20040000 : 0x20041000;
-            }
-        }
-        return sp - ref;
+    // Bytes between the stack pointer and the bottom of this core's stack
+    int getFreeStack();
+
+    // Most stack this core has ever used, in bytes.  Stacks are filled with a
+    // known pattern at boot and this finds the deepest word overwritten
+    int getStackHighWater();
+
+    // Total bytes available for this core's stack
+    int getStackSize();
+
+    // Internal, paint a core's stack region (below the SP if it's the calling core's)
+    // and guard its bottom with an MPU region if core_stack_guard is set
+    void _paintStack(int core, uint32_t *bottom, uint32_t *top);
+    void _guardStack();
+
+    // XIP cache counters, shared by both cores and counting every flash read
+    // (code and const data) since boot or the last reset.  They stop at 0xffffffff
+    inline uint32_t getXIPCacheHits() {
+        return xip_ctrl_hw->ctr_hit;
+    }
+
+    inline uint32_t getXIPCacheAccesses() {
+        return xip_ctrl_hw->ctr_acc;
+    }
+
+    inline void resetXIPCacheStats() {
+        xip_ctrl_hw->ctr_hit = 0;
+        xip_ctrl_hw->ctr_acc = 0;
     }
 
     void idleOtherCore() {
@@ -269,6 +267,12 @@ public:
         fifo.resumeOtherCore();
     }
 
+    // Called repeatedly on this core while it is parked for a flash write on the other one.  Must be
+    // entirely in RAM (__not_in_flash_func) and touch no flash-resident code or const data.  nullptr to remove
+    void setParkedCallback(void (*cb)()) {
+        __parkedCallback[get_core_num()] = cb;
+    }
+
     void restartCore1() {
         multicore_reset_core1();
         fifo.clear();
@@ -330,10 +334,5 @@ public:
 
 
 private:
-    static void _SystickHandler() {
-        rp2040._epoch += 1LL << 24;
-    }
-    PIO _pio;
-    int _sm;
-    PIOProgram *_ccountPgm;
+    static void _resetCycleCount();
 };
@@ -0,0 +1,388 @@
+/*
+    Hierarchical timer wheel for large numbers of software timers
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "TimerWheel.h"
+#include <hardware/timer.h>
+#include <hardware/sync.h>
+
+TimerWheel timerWheel;
+
+// Protects the wheel, the queues, and every SoftTimer's bookkeeping.  Claimed by the
+// first _start(), until then nothing can be in the wheel or the queues
+static spin_lock_t *_wheelLock = nullptr;
+
+static void _claimWheelLock() {
+    // Both cores could get here at once, so use a shared lock to claim our own
+    spin_lock_t *l = spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST);
+    uint32_t save = spin_lock_blocking(l);
+    if (!_wheelLock) {
+        spin_lock_t *w = spin_lock_init(spin_lock_claim_unused(true));
+        __mem_fence_release();
+        _wheelLock = w;
+    }
+    spin_unlock(l, save);
+}
+
+static inline uint64_t __not_in_flash_func(_nowTick)() {
+    return time_us_64() / TIMERWHEEL_TICK_US;
+}
+
+static void __not_in_flash_func(_alarmCB)(uint alarm) {
+    (void) alarm;
+    timerWheel._irq();
+}
+
+bool SoftTimer::start(uint32_t us, uint32_t periodUs) {
+    return timerWheel._start(this, us, periodUs);
+}
+
+void SoftTimer::stop() {
+    timerWheel._stop(this);
+}
+
+SoftTimer::~SoftTimer() {
+    timerWheel._stop(this, true);
+}
+
+bool TimerWheel::_start(SoftTimer *t, uint32_t us, uint32_t periodUs) {
+    if (!t->_fn) {
+        DEBUGCORE("ERROR: SoftTimer started without a callback\n");
+        return false;
+    }
+    if (!_wheelLock) {
+        _claimWheelLock();
+    }
+    uint32_t save = spin_lock_blocking(_wheelLock);
+    if (_alarm < 0) {
+        // IRQs will be handled on this core from now on
+        _alarm = hardware_alarm_claim_unused(false);
+        if (_alarm < 0) {
+            spin_unlock(_wheelLock, save);
+            DEBUGCORE("ERROR: TimerWheel unable to claim a timer alarm\n");
+            return false;
+        }
+        _tick = _nowTick();
+        hardware_alarm_set_callback(_alarm, _alarmCB);
+    }
+    if (t->_level >= 0) {
+        unlink(t);
+    }
+    if (!(_busy[0] | _busy[1] | _busy[2] | _busy[3])) {
+        // _tick only moves in the IRQ, so after being idle it could be hours behind and the
+        // IRQ would then have to step through every cascade in between.  Nothing depends on it now
+        _tick = _nowTick();
+    }
+    t->_pending = 0;
+    t->_expires = max(_tick + 1, (time_us_64() + us + TIMERWHEEL_TICK_US - 1) / TIMERWHEEL_TICK_US);
+    t->_period = (periodUs + TIMERWHEEL_TICK_US - 1) / TIMERWHEEL_TICK_US;
+    place(t);
+    arm();
+    spin_unlock(_wheelLock, save);
+    return true;
+}
+
+void TimerWheel::_stop(SoftTimer *t, bool wait) {
+    if (!_wheelLock) {
+        return; // Nothing has been started yet
+    }
+    uint32_t save = spin_lock_blocking(_wheelLock);
+    if (t->_level >= 0) {
+        unlink(t);
+    }
+    t->_pending = 0;
+    dequeue(t, &_irqQueue);
+    dequeue(t, &_deferredQueue);
+    if (_irqQueue.run == t) {
+        _irqQueue.runLeft = 0;
+    }
+    if (_deferredQueue.run == t) {
+        _deferredQueue.runLeft = 0;
+    }
+    spin_unlock(_wheelLock, save);
+    // A callback running on this core is either what we're called from or what we interrupted, so can't be waited for
+    while (wait) {
+        save = spin_lock_blocking(_wheelLock);
+        int core = get_core_num();
+        wait = ((_irqQueue.run == t) && (_irqQueue.core != core)) || ((_deferredQueue.run == t) && (_deferredQueue.core != core));
+        spin_unlock(_wheelLock, save);
+    }
+}
+
+// Called with the lock held.  Timers due at _tick itself only happen while cascading, and go in
+// the level 0 slot about to be expired
+void TimerWheel::place(SoftTimer *t) {
+    uint64_t delta = t->_expires - _tick;
+    uint64_t when = t->_expires;
+    if (delta >= (1ULL << (BITS * LEVELS))) {
+        // Beyond the wheel, park at the top level and re-place when it cascades down
+        when = _tick + (1ULL << (BITS * LEVELS)) - 1;
+        delta = when - _tick;
+    }
+    int level = 0;
+    while ((level < LEVELS - 1) && (delta >= (1ULL << (BITS * (level + 1))))) {
+        level++;
+    }
+    int slot = (when >> (BITS * level)) & (SLOTS - 1);
+    t->_level = level;
+    t->_slot = slot;
+    t->_prev = nullptr;
+    t->_next = _slot[level][slot];
+    if (t->_next) {
+        t->_next->_prev = t;
+    }
+    _slot[level][slot] = t;
+    _busy[level] |= 1ULL << slot;
+}
+
+// Called with the lock held
+void TimerWheel::unlink(SoftTimer *t) {
+    if (t->_prev) {
+        t->_prev->_next = t->_next;
+    } else {
+        _slot[t->_level][t->_slot] = t->_next;
+    }
+    if (t->_next) {
+        t->_next->_prev = t->_prev;
+    }
+    if (!_slot[t->_level][t->_slot]) {
+        _busy[t->_level] &= ~(1ULL << t->_slot);
+    }
+    t->_next = nullptr;
+    t->_prev = nullptr;
+    t->_level = -1;
+}
+
+// Called with the lock held at the start of each period of this level, moves its slot's timers down
+void TimerWheel::cascade(int level) {
+    int idx = (_tick >> (BITS * level)) & (SLOTS - 1);
+    SoftTimer *t = _slot[level][idx];
+    _slot[level][idx] = nullptr;
+    _busy[level] &= ~(1ULL << idx);
+    while (t) {
+        SoftTimer *next = t->_next;
+        place(t);
+        t = next;
+    }
+}
+
+// Called with the lock held, queues everything due at _tick
+void TimerWheel::expire() {
+    int idx = _tick & (SLOTS - 1);
+    SoftTimer *t = _slot[0][idx];
+    if (!t) {
+        return;
+    }
+    _slot[0][idx] = nullptr;
+    _busy[0] &= ~(1ULL << idx);
+    uint64_t late = time_us_64() - _tick * TIMERWHEEL_TICK_US;
+    while (t) {
+        SoftTimer *next = t->_next;
+        t->_level = -1;
+        queue(t, t->_deferred ? &_deferredQueue : &_irqQueue);
+        _stats.fired++;
+        _stats.totalLateUs += late;
+        if (late > TIMERWHEEL_TICK_US) {
+            _stats.late++;
+        }
+        if (late > _stats.maxLateUs) {
+            _stats.maxLateUs = late;
+        }
+        if (t->_period) {
+            t->_expires += t->_period;
+            place(t);
+        }
+        t = next;
+    }
+}
+
+// Called with the lock held
+void TimerWheel::queue(SoftTimer *t, Queue *q) {
+    if (t->_pending < UINT16_MAX) {
+        t->_pending++;
+    }
+    if (!t->_queued) {
+        t->_queued = true;
+        t->_fire = nullptr;
+        if (q->tail) {
+            q->tail->_fire = t;
+        } else {
+            q->head = t;
+        }
+        q->tail = t;
+    }
+}
+
+// Called with the lock held
+void TimerWheel::dequeue(SoftTimer *t, Queue *q) {
+    SoftTimer *prev = nullptr;
+    for (SoftTimer *p = q->head; p; prev = p, p = p->_fire) {
+        if (p == t) {
+            if (prev) {
+                prev->_fire = t->_fire;
+            } else {
+                q->head = t->_fire;
+            }
+            if (q->tail == t) {
+                q->tail = prev;
+            }
+            t->_fire = nullptr;
+            t->_queued = false;
+            return;
+        }
+    }
+}
+
+void TimerWheel::runQueue(Queue *q) {
+    uint32_t save = spin_lock_blocking(_wheelLock);
+    q->core = get_core_num();
+    // Only run what is queued now, so timers firing faster than their callbacks can't keep us here forever
+    int count = 0;
+    for (SoftTimer *t = q->head; t; t = t->_fire) {
+        count++;
+    }
+    spin_unlock(_wheelLock, save);
+    while (count--) {
+        save = spin_lock_blocking(_wheelLock);
+        SoftTimer *t = q->head;
+        if (!t) {
+            spin_unlock(_wheelLock, save);
+            break;
+        }
+        q->head = t->_fire;
+        if (!q->head) {
+            q->tail = nullptr;
+        }
+        t->_fire = nullptr;
+        t->_queued = false;
+        q->run = t;
+        q->runLeft = t->_pending;
+        t->_pending = 0;
+        // The callback may stop or even delete its own timer, so don't touch it after this
+        void (*fn)(void *) = t->_fn;
+        void *arg = t->_arg;
+        spin_unlock(_wheelLock, save);
+        while (true) {
+            save = spin_lock_blocking(_wheelLock);
+            if (!q->runLeft) {
+                q->run = nullptr;
+                spin_unlock(_wheelLock, save);
+                break;
+            }
+            q->runLeft--;
+            spin_unlock(_wheelLock, save);
+            fn(arg);
+        }
+    }
+}
+
+// Called with the lock held.  The next tick where anything can happen, which is
+// either a level 0 slot with timers in it or the next cascade
+uint64_t TimerWheel::nextTick() {
+    int idx = _tick & (SLOTS - 1);
+    uint64_t base = _tick & ~(uint64_t)(SLOTS - 1);
+    uint64_t after = (idx == SLOTS - 1) ? 0 : _busy[0] & (~0ULL << (idx + 1));
+    if (after) {
+        return base + __builtin_ctzll(after);
+    }
+    if (_busy[1] | _busy[2] | _busy[3]) {
+        return base + SLOTS;
+    }
+    if (_busy[0]) {
+        return base + SLOTS + __builtin_ctzll(_busy[0]);
+    }
+    return UINT64_MAX;
+}
+
+// Called with the lock held
+void TimerWheel::arm() {
+    uint64_t next = nextTick();
+    if (next == UINT64_MAX) {
+        if (_armed != UINT64_MAX) {
+            hardware_alarm_cancel(_alarm);
+            _armed = UINT64_MAX;
+        }
+        return;
+    }
+    if (next >= _armed) {
+        return;
+    }
+    _armed = next;
+    if (hardware_alarm_set_target(_alarm, from_us_since_boot(next * TIMERWHEEL_TICK_US))) {
+        // Already passed
+        hardware_alarm_force_irq(_alarm);
+    }
+}
+
+void __not_in_flash_func(TimerWheel::_irq)() {
+    uint32_t save = spin_lock_blocking(_wheelLock);
+    _armed = UINT64_MAX;
+    uint64_t now = _nowTick();
+    while (_tick < now) {
+        uint64_t next = nextTick();
+        if (next > now) {
+            _tick = now;
+            break;
+        }
+        _tick = next;
+        for (int l = 1; (l < LEVELS) && !(_tick & ((1ULL << (BITS * l)) - 1)); l++) {
+            cascade(l);
+        }
+        expire();
+    }
+    spin_unlock(_wheelLock, save);
+
+    if (_irqQueue.head) {
+        runQueue(&_irqQueue);
+    }
+
+    save = spin_lock_blocking(_wheelLock);
+    arm();
+    spin_unlock(_wheelLock, save);
+}
+
+void TimerWheel::runDeferred() {
+    if (_deferredQueue.head) {
+        runQueue(&_deferredQueue);
+    }
+}
+
+TimerWheel::Stats TimerWheel::stats() {
+    if (!_wheelLock) {
+        return _stats;
+    }
+    uint32_t save = spin_lock_blocking(_wheelLock);
+    Stats s = _stats;
+    spin_unlock(_wheelLock, save);
+    return s;
+}
+
+void TimerWheel::resetStats() {
+    if (!_wheelLock) {
+        return;
+    }
+    uint32_t save = spin_lock_blocking(_wheelLock);
+    _stats = { 0, 0, 0, 0 };
+    spin_unlock(_wheelLock, save);
+}
+
+// Only linked in when a sketch or library uses SoftTimer
+void __timerWheelRun() {
+    timerWheel.runDeferred();
+}
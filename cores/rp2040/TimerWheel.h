@@ -0,0 +1,146 @@
+/*
+    Hierarchical timer wheel for large numbers of software timers
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    Any number of SoftTimers share 1 hardware alarm.  They live in 4 levels of
+    64 slots (1, 64, 4096 and 262144 ticks apart), so starting and stopping one
+    is O(1) and the alarm only fires when a slot has something due.  Timers
+    are owned by the caller, nothing is allocated.
+
+        void blink(void *) { digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); }
+        SoftTimer t(blink);
+        ...
+        t.start(250000, 250000);     // In 250ms, then every 250ms
+
+    Callbacks run in the timer IRQ, on the core which first started a timer,
+    unless created as deferred.  Deferred callbacks run from the core 0 loop,
+    where they can use anything a sketch can.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Resolution of all SoftTimers, in microseconds
+#ifndef TIMERWHEEL_TICK_US
+#define TIMERWHEEL_TICK_US 1000
+#endif
+
+class SoftTimer {
+public:
+    constexpr SoftTimer(void (*fn)(void *) = nullptr, void *arg = nullptr, bool deferred = false) : _deferred(deferred), _fn(fn), _arg(arg) {
+    }
+    // Stops the timer, and waits for its callback if it is running on the other core
+    ~SoftTimer();
+
+    // Only while stopped
+    void setCallback(void (*fn)(void *), void *arg = nullptr, bool deferred = false) {
+        _fn = fn;
+        _arg = arg;
+        _deferred = deferred;
+    }
+
+    // Fire no sooner than us from now, then every periodUs if not 0.  Restarts if already running
+    bool start(uint32_t us, uint32_t periodUs = 0);
+
+    // Safe from any core or IRQ, and from the callback itself.  No callbacks start after this
+    void stop();
+
+    bool active() const {
+        return _level >= 0;
+    }
+
+private:
+    friend class TimerWheel;
+    SoftTimer *_next = nullptr;         // Wheel slot list
+    SoftTimer *_prev = nullptr;
+    SoftTimer *_fire = nullptr;         // Run queue list
+    uint64_t _expires = 0;              // In ticks
+    uint32_t _period = 0;
+    uint16_t _pending = 0;              // Callbacks owed, more than 1 if a deferred timer fell behind
+    int8_t _level = -1;
+    uint8_t _slot = 0;
+    bool _queued = false;
+    bool _deferred;
+    void (*_fn)(void *);
+    void *_arg;
+};
+
+class TimerWheel {
+public:
+    typedef struct {
+        uint32_t fired;
+        uint32_t late;          // Ran more than 1 tick after they were due
+        uint32_t maxLateUs;
+        uint64_t totalLateUs;
+    } Stats;
+
+    // Constant-initialised so timers may be started from other static constructors.
+    // The spinlock and alarm are claimed by the first _start()
+    constexpr TimerWheel() : _slot{}, _busy{}, _tick(0), _armed(UINT64_MAX), _irqQueue{nullptr, nullptr, nullptr, 0, -1},
+        _deferredQueue{nullptr, nullptr, nullptr, 0, -1}, _alarm(-1), _stats{0, 0, 0, 0} {
+    }
+
+    Stats stats();
+    void resetStats();
+
+    // Runs deferred callbacks, called after every loop() on core 0
+    void runDeferred();
+
+    // Internal
+    bool _start(SoftTimer *t, uint32_t us, uint32_t periodUs);
+    void _stop(SoftTimer *t, bool wait = false);
+    void _irq();
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOTS = 64;
+    static constexpr int BITS = 6;
+
+    // Timers which have fired, waiting for their callbacks to run in order
+    typedef struct {
+        SoftTimer *head;
+        SoftTimer *tail;
+        SoftTimer *run;         // Callback running now.  The timer itself isn't touched once it starts
+        uint16_t runLeft;       // Further calls owed to it, cleared by stop()
+        int8_t core;            // Core running this queue
+    } Queue;
+
+    void place(SoftTimer *t);
+    void unlink(SoftTimer *t);
+    void cascade(int level);
+    void expire();
+    void queue(SoftTimer *t, Queue *q);
+    void dequeue(SoftTimer *t, Queue *q);
+    void runQueue(Queue *q);
+    uint64_t nextTick();
+    void arm();
+
+    SoftTimer *_slot[LEVELS][SLOTS];
+    uint64_t _busy[LEVELS];     // Bit per non-empty slot
+    uint64_t _tick;             // Everything up to here has been handled
+    uint64_t _armed;            // Tick the alarm is set for
+    Queue _irqQueue;
+    Queue _deferredQueue;
+    int _alarm;
+    Stats _stats;
+};
+
+extern TimerWheel timerWheel;
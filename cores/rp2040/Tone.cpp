@@ -21,7 +21,7 @@
 #include <Arduino.h>
 #include "CoreMutex.h"
 #include <hardware/gpio.h>
-#include <pico/time.h>
+#include "TimerWheel.h"
 #include <map>
 
 typedef struct {
@@ -29,7 +29,7 @@ typedef struct {
     PIO pio;
     int sm;
     int off;
-    alarm_id_t alarm;
+    SoftTimer stop;
 } Tone;
 
 // Keep std::map safe for multicore use
@@ -45,14 +45,11 @@ static inline bool pio_sm_get_enabled(PIO pio, uint sm) {
     return (pio->ctrl & ~(1u << sm)) & (1 << sm);
 }
 
-int64_t _stopTonePIO(alarm_id_t id, void *user_data) {
-    (void) id;
+void _stopTonePIO(void *user_data) {
     Tone *tone = (Tone *)user_data;
-    tone->alarm = 0;
     digitalWrite(tone->pin, LOW);
     pinMode(tone->pin, OUTPUT);
     pio_sm_set_enabled(tone->pio, tone->sm, false);
-    return 0;
 }
 
 void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
@@ -87,13 +84,10 @@ void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
             delete newTone;
             return;
         }
-        newTone->alarm = 0;
+        newTone->stop.setCallback(_stopTonePIO, (void *)newTone);
     } else {
         newTone = entry->second;
-        if (newTone->alarm) {
-            cancel_alarm(newTone->alarm);
-            newTone->alarm = 0;
-        }
+        newTone->stop.stop();
     }
     if (!pio_sm_get_enabled(newTone->pio, newTone->sm)) {
         tone2_program_init(newTone->pio, newTone->sm, newTone->off, pin);
@@ -105,10 +99,8 @@ void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
     _toneMap.insert({pin, newTone});
 
     if (duration) {
-        auto ret = add_alarm_in_ms(duration, _stopTonePIO, (void *)newTone, true);
-        if (ret > 0) {
-            newTone->alarm = ret;
-        } else {
+        // SoftTimers go up to ~71 minutes
+        if (!newTone->stop.start(min(duration, 4294967UL) * 1000)) {
             DEBUGCORE("ERROR: Unable to allocate timer for tone(%d, %d, %lu)\n",
                       pin, frequency, duration);
         }
@@ -124,10 +116,7 @@ void noTone(uint8_t pin) {
     }
     auto entry = _toneMap.find(pin);
     if (entry != _toneMap.end()) {
-        if (entry->second->alarm) {
-            cancel_alarm(entry->second->alarm);
-            entry->second->alarm = 0;
-        }
+        entry->second->stop.stop();
         pio_sm_set_enabled(entry->second->pio, entry->second->sm, false);
         pio_sm_unclaim(entry->second->pio, entry->second->sm);
         delete entry->second;
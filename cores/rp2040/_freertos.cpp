@@ -23,40 +23,119 @@
 #include <stdlib.h>
 #include "Arduino.h"
 
+#include <hardware/sync.h>
+
+// Open-addressed hash from pico mutex_t to FreeRTOS semaphore.  Entries are
+// only ever added, and an entry's semaphore is written before its key, so
+// lookups need no lock at all.  Inserts and growth are serialized by a
+// spinlock, and a table replaced by a larger one is never freed because another
+// core may still be reading it.
 typedef struct {
-    mutex_t *src;
+    mutex_t *volatile src;
     SemaphoreHandle_t dst;
 } FMMap;
 
-static FMMap *_map = nullptr;
-SemaphoreHandle_t __get_freertos_mutex_for_ptr(mutex_t *m, bool recursive) {
-    if (!_map) {
-        _map = (FMMap *)calloc(sizeof(FMMap), 16);
-    }
-    // Pre-existing map
-    for (int i = 0; i < 16; i++) {
-        if (m == _map[i].src) {
-            return _map[i].dst;
+typedef struct {
+    uint32_t mask;
+    uint32_t used;
+    FMMap *e;
+} FMTable;
+
+static FMMap _initialEntries[32];
+static FMTable _initialTable = { 31, 0, _initialEntries };
+static FMTable *volatile _map = &_initialTable;
+
+static inline uint32_t _fmHash(mutex_t *m) {
+    uint32_t h = ((uint32_t)m >> 2) * 2654435761u;
+    return h ^ (h >> 16);
+}
+
+static SemaphoreHandle_t _fmFind(FMTable *t, mutex_t *m) {
+    for (uint32_t i = _fmHash(m); ; i++) {
+        FMMap *e = &t->e[i & t->mask];
+        mutex_t *src = e->src;
+        if (src == m) {
+            __dmb();
+            return e->dst;
+        } else if (!src) {
+            return nullptr;
         }
     }
+}
 
-    for (int i = 0; i < 16; i++) {
-        if (_map[i].src == nullptr) {
-            // Make a new mutex
-            SemaphoreHandle_t fm;
-            if (recursive) {
-                fm = _freertos_recursive_mutex_create();
-            } else {
-                fm = __freertos_mutex_create();
-            }
-            if (fm == nullptr) {
-                return nullptr;
-            }
+static void _fmInsert(FMTable *t, mutex_t *m, SemaphoreHandle_t fm) {
+    uint32_t i = _fmHash(m);
+    while (t->e[i & t->mask].src) {
+        i++;
+    }
+    t->e[i & t->mask].dst = fm;
+    __dmb();
+    t->e[i & t->mask].src = m;
+    t->used++;
+}
 
-            _map[i].src = m;
-            _map[i].dst = fm;
+SemaphoreHandle_t __get_freertos_mutex_for_ptr(mutex_t *m, bool recursive) {
+    SemaphoreHandle_t fm = _fmFind(_map, m);
+    if (fm) {
+        return fm;
+    }
+
+    // Make a new mutex outside of the lock, since this may need to malloc
+    if (recursive) {
+        fm = _freertos_recursive_mutex_create();
+    } else {
+        fm = __freertos_mutex_create();
+    }
+    if (fm == nullptr) {
+        return nullptr;
+    }
+
+    spin_lock_t *lock = spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST);
+    while (true) {
+        uint32_t save = spin_lock_blocking(lock);
+        FMTable *t = _map;
+        SemaphoreHandle_t other = _fmFind(t, m);
+        if (other) {
+            // Lost a race with another task mapping the same mutex
+            spin_unlock(lock, save);
+            __freertos_mutex_delete(fm);
+            return other;
+        }
+        if ((t->used + 1) * 4 <= (t->mask + 1) * 3) {
+            _fmInsert(t, m, fm);
+            spin_unlock(lock, save);
             return fm;
         }
+        spin_unlock(lock, save);
+
+        // Over 75% full, double the size and try again
+        FMTable *n = (FMTable *)malloc(sizeof(FMTable));
+        FMMap *e = (FMMap *)calloc(sizeof(FMMap), (t->mask + 1) * 2);
+        if (!n || !e) {
+            free(n);
+            free(e);
+            __freertos_mutex_delete(fm);
+            return nullptr;
+        }
+        n->mask = (t->mask + 1) * 2 - 1;
+        n->used = 0;
+        n->e = e;
+        save = spin_lock_blocking(lock);
+        if (_map == t) {
+            for (uint32_t i = 0; i <= t->mask; i++) {
+                if (t->e[i].src) {
+                    _fmInsert(n, t->e[i].src, t->e[i].dst);
+                }
+            }
+            __dmb();
+            _map = n;
+            n = nullptr;
+        }
+        spin_unlock(lock, save);
+        if (n) {
+            // Someone else already grew it
+            free(n->e);
+            free(n);
+        }
     }
-    return nullptr; // Need to make space for more mutex maps!
 }
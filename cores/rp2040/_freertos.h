@@ -42,6 +42,7 @@ extern "C" {
 
     extern SemaphoreHandle_t __freertos_mutex_create() __attribute__((weak));
     extern SemaphoreHandle_t _freertos_recursive_mutex_create() __attribute__((weak));
+    extern void __freertos_mutex_delete(SemaphoreHandle_t mtx) __attribute__((weak));
 
     extern void __freertos_mutex_take(SemaphoreHandle_t mtx) __attribute__((weak));
 
@@ -28,10 +28,17 @@
 extern "C" void delay(unsigned long ms) __attribute__((weak));
 extern "C" void yield() __attribute__((weak));
 
+// Only present when the sketch uses AsyncTask
+extern "C" bool __asyncDelay(unsigned long ms) __attribute__((weak));
+extern "C" void __asyncYield() __attribute__((weak));
+
 extern "C"
 {
 
     void delay(unsigned long ms) {
+        if (__asyncDelay && __asyncDelay(ms)) {
+            return;
+        }
         if (!ms) {
             return;
         }
@@ -51,6 +58,9 @@ extern "C"
         TinyUSB_Device_Task();
         TinyUSB_Device_FlushCDC();
 #endif
+        if (__asyncYield) {
+            __asyncYield();
+        }
     }
 
 
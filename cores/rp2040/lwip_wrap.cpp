@@ -30,6 +30,7 @@
 #include <pico/mutex.h>
 #include <sys/lock.h>
 #include "_xoshiro.h"
+#include "CoreTrace.h"
 
 extern void ethernet_arch_lwip_begin() __attribute__((weak));
 extern void ethernet_arch_lwip_end() __attribute__((weak));
@@ -41,12 +42,15 @@ auto_init_recursive_mutex(__lwipMutex); // Only for case with no Ethernet or Pic
 class LWIPMutex {
 public:
     LWIPMutex() {
+        CORE_TRACE_BEGIN(CORE_TRACE_LWIP_WAIT, 0, 0);
         if (ethernet_arch_lwip_gpio_mask)  {
             ethernet_arch_lwip_gpio_mask();
         }
 #if defined(ARDUINO_RASPBERRY_PI_PICO_W)
         if (rp2040.isPicoW()) {
             cyw43_arch_lwip_begin();
+            CORE_TRACE_END(CORE_TRACE_LWIP_WAIT, 0, 0);
+            CORE_TRACE_BEGIN(CORE_TRACE_LWIP_LOCK, 0, 0);
             return;
         }
 #endif
@@ -55,9 +59,12 @@ public:
         } else {
             recursive_mutex_enter_blocking(&__lwipMutex);
         }
+        CORE_TRACE_END(CORE_TRACE_LWIP_WAIT, 0, 0);
+        CORE_TRACE_BEGIN(CORE_TRACE_LWIP_LOCK, 0, 0);
     }
 
     ~LWIPMutex() {
+        CORE_TRACE_END(CORE_TRACE_LWIP_LOCK, 0, 0);
 #if defined(ARDUINO_RASPBERRY_PI_PICO_W)
         if (rp2040.isPicoW()) {
             cyw43_arch_lwip_end();
@@ -27,6 +27,7 @@
 RP2040 rp2040;
 extern "C" {
     volatile bool __otherCoreIdled = false;
+    void (*volatile __parkedCallback[2])() = { nullptr, nullptr };
     uint32_t* core1_separate_stack_address = nullptr;
 };
 
@@ -47,16 +48,35 @@ void initVariant() { }
 
 // Optional 2nd core setup and loop
 bool core1_separate_stack __attribute__((weak)) = false;
+// Set to true in the sketch to trap stack overflows with the MPU
+bool core_stack_guard __attribute__((weak)) = false;
 extern void setup1() __attribute__((weak));
 extern void loop1() __attribute__((weak));
+// Only present when the sketch uses coreExecutor, which needs core 1 running
+extern void __executorRun(bool block) __attribute__((weak));
+// Only present when the sketch uses AsyncTask
+extern void __asyncRun() __attribute__((weak));
+// Only present when something uses SoftTimer
+extern void __timerWheelRun() __attribute__((weak));
+extern void __initGPIOInterrupts();
 extern "C" void main1() {
+    rp2040._guardStack();
     rp2040.fifo.registerCore();
+    __initGPIOInterrupts();
     if (setup1) {
         setup1();
     }
     while (true) {
         if (loop1) {
             loop1();
+            if (__asyncRun) {
+                __asyncRun();
+            }
+            if (__executorRun) {
+                __executorRun(false);
+            }
+        } else if (__executorRun) {
+            __executorRun(true);
         }
     }
 }
@@ -75,9 +95,39 @@ extern void __loop() {
     if (arduino::serialEvent2Run) {
         arduino::serialEvent2Run();
     }
+
+    if (__asyncRun) {
+        __asyncRun();
+    }
+
+    if (__timerWheelRun) {
+        __timerWheelRun();
+    }
+
+    if (__executorRun) {
+        __executorRun(false);
+    }
 }
 static struct _reent *_impure_ptr1 = nullptr;
 
+extern "C" uint32_t __scratch_x_end__[], __scratch_y_start__[], __scratch_y_end__[];
+extern "C" uint32_t __StackTop[], __StackOneTop[];
+
+// Fill the stacks with a known pattern so rp2040.getStackHighWater() can find
+// how deep they have ever gone.  Core 0 gets all of SCRATCH_X and SCRATCH_Y
+// unless core 1 is going to use SCRATCH_X for its own stack.
+static void __paintStacks() {
+    bool core1ScratchStack = __isFreeRTOS || ((setup1 || loop1 || __executorRun) && !core1_separate_stack);
+    uint32_t *bottom0 = __scratch_x_end__;
+    if (core1ScratchStack || (__scratch_y_end__ != __scratch_y_start__)) {
+        bottom0 = __scratch_y_end__;
+    }
+    rp2040._paintStack(0, bottom0, __StackTop);
+    if (core1ScratchStack) {
+        rp2040._paintStack(1, __scratch_x_end__, __StackOneTop);
+    }
+}
+
 extern "C" int main() {
 #if F_CPU != 125000000
     set_sys_clock_khz(F_CPU / 1000, true);
@@ -87,12 +137,14 @@ extern "C" int main() {
     __isFreeRTOS = initFreeRTOS ? true : false;
 
     // Allocate impure_ptr (newlib temps) if there is a 2nd core running
-    if (!__isFreeRTOS && (setup1 || loop1)) {
+    if (!__isFreeRTOS && (setup1 || loop1 || __executorRun)) {
         _impure_ptr1 = (struct _reent*)calloc(sizeof(struct _reent), 1);
         _REENT_INIT_PTR(_impure_ptr1);
     }
 
     rp2040.begin();
+    __paintStacks();
+    rp2040._guardStack();
 
     initVariant();
 
@@ -127,7 +179,7 @@ extern "C" int main() {
 #endif
 
     if (!__isFreeRTOS) {
-        if (setup1 || loop1) {
+        if (setup1 || loop1 || __executorRun) {
             rp2040.fifo.begin(2);
         } else {
             rp2040.fifo.begin(1);
@@ -136,15 +188,17 @@ extern "C" int main() {
     }
 
     if (!__isFreeRTOS) {
-        if (setup1 || loop1) {
+        if (setup1 || loop1 || __executorRun) {
             delay(1); // Needed to make Picoprobe upload start 2nd core
             if (core1_separate_stack) {
                 core1_separate_stack_address = (uint32_t*)malloc(0x2000);
+                rp2040._paintStack(1, core1_separate_stack_address, core1_separate_stack_address + 0x2000 / sizeof(uint32_t));
                 multicore_launch_core1_with_stack(main1, core1_separate_stack_address, 0x2000);
             } else {
                 multicore_launch_core1(main1);
             }
         }
+        __initGPIOInterrupts();
         setup();
         while (true) {
             loop();
@@ -19,35 +19,508 @@
 */
 
 #include <Arduino.h>
+#include <hardware/sync.h>
+#include <malloc.h>
+#include <reent.h>
+#include <new>
+#include <bits/functexcept.h>
+#include "HeapStats.h"
 
 extern "C" void *__real_malloc(size_t size);
 extern "C" void *__real_calloc(size_t count, size_t size);
 extern "C" void *__real_realloc(void *mem, size_t size);
 extern "C" void __real_free(void *mem);
+extern "C" void __malloc_lock(struct _reent *r);
+extern "C" void __malloc_unlock(struct _reent *r);
+
+// Optional per-core small-block caches.  Define "size_t percore_heap_cache = 16384;" (bytes per core)
+// in the sketch to enable.  Blocks of up to 256 bytes then come from an arena owned by the allocating
+// core, with only that core's IRQs disabled and no cross-core locking.  Larger blocks, or any once the
+// arena is full, use the shared newlib heap as before.
+size_t percore_heap_cache __attribute__((weak)) = 0;
+
+// Optional allocation call site counting.  Define "size_t heap_stats_callers = 64;" in the sketch to
+// track up to that many distinct callers of malloc/calloc/realloc (rounded up to a power of 2).
+size_t heap_stats_callers __attribute__((weak)) = 0;
+
+namespace {
+
+constexpr int CLASSES = 6;      // 8, 16, 32, 64, 128, 256 bytes
+constexpr size_t MAX_SMALL = 8 << (CLASSES - 1);
+constexpr size_t PAGE = 512;    // Arena is carved into pages, each holding blocks of 1 size class
+constexpr int MAX_PAGES = 128;
+
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct {
+    uint8_t *base;              // nullptr until first use on this core
+    uint8_t *end;
+    int pages;
+    int nextPage;
+    uint8_t cls[MAX_PAGES];     // Size class of each page in use
+    FreeBlock *free[CLASSES];   // Only touched by the owning core
+    FreeBlock *remote[CLASSES]; // Freed by the other core, protected by remoteLock()
+    bool failed;
+} Arena;
+
+Arena _arena[2];
+// Only held for a couple of instructions, so one of the SDK's shared striped locks is fine
+inline spin_lock_t *remoteLock() {
+    return spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST);
+}
+
+inline int sizeToClass(size_t size) {
+    int c = 0;
+    size_t s = 8;
+    while (s < size) {
+        s <<= 1;
+        c++;
+    }
+    return c;
+}
+
+inline Arena *owner(void *p) {
+    for (int i = 0; i < 2; i++) {
+        if (((uint8_t *)p >= _arena[i].base) && ((uint8_t *)p < _arena[i].end)) {
+            return &_arena[i];
+        }
+    }
+    return nullptr;
+}
+
+inline size_t blockSize(Arena *a, void *p) {
+    return 8 << a->cls[((uint8_t *)p - a->base) / PAGE];
+}
+
+// Called with this core's IRQs disabled
+bool arenaInit(Arena *a) {
+    if (a->failed) {
+        return false;
+    }
+    size_t pages = min((size_t)MAX_PAGES, percore_heap_cache / PAGE);
+    a->base = pages ? (uint8_t *)__real_malloc(pages * PAGE) : nullptr;
+    if (!a->base) {
+        a->failed = true;
+        return false;
+    }
+    a->end = a->base + pages * PAGE;
+    a->pages = pages;
+    a->nextPage = 0;
+    return true;
+}
+
+// Called with this core's IRQs disabled
+void *arenaAlloc(size_t size) {
+    Arena *a = &_arena[get_core_num()];
+    if (!a->base && !arenaInit(a)) {
+        return nullptr;
+    }
+    int c = sizeToClass(size ? size : 1);
+    FreeBlock *b = a->free[c];
+    if (!b && a->remote[c]) {
+        // Take back everything the other core freed for this class in 1 go
+        uint32_t save = spin_lock_blocking(remoteLock());
+        b = a->remote[c];
+        a->remote[c] = nullptr;
+        spin_unlock(remoteLock(), save);
+    }
+    if (!b && (a->nextPage < a->pages)) {
+        // Carve a fresh page into blocks of this class
+        int pg = a->nextPage++;
+        a->cls[pg] = c;
+        size_t bs = 8 << c;
+        uint8_t *p = a->base + pg * PAGE;
+        for (size_t off = PAGE - bs; off > 0; off -= bs) {
+            FreeBlock *f = (FreeBlock *)(p + off);
+            f->next = b;
+            b = f;
+        }
+        ((FreeBlock *)p)->next = b;
+        b = (FreeBlock *)p;
+    }
+    if (!b) {
+        return nullptr;
+    }
+    a->free[c] = b->next;
+    return b;
+}
+
+// Called with this core's IRQs disabled
+void arenaFree(Arena *a, void *p) {
+    int c = a->cls[((uint8_t *)p - a->base) / PAGE];
+    FreeBlock *b = (FreeBlock *)p;
+    if (a == &_arena[get_core_num()]) {
+        b->next = a->free[c];
+        a->free[c] = b;
+    } else {
+        uint32_t save = spin_lock_blocking(remoteLock());
+        b->next = a->remote[c];
+        a->remote[c] = b;
+        spin_unlock(remoteLock(), save);
+    }
+}
+
+// Usage counters, kept per core so the per-core arenas still never wait on the other core.
+// Blocks are counted by their real (rounded up) size, so a block freed on the other core
+// comes out of the same bucket it went into.
+typedef struct {
+    int32_t used;
+    uint32_t peak;
+    uint32_t failed;
+    HeapStats::Bucket bucket[HeapStats::BUCKETS];
+} CoreStats;
+
+CoreStats _stats[2];
+
+HeapStats::Site *_site;
+uint32_t _siteMask;
+uint32_t _siteDropped;
+bool _siteFailed;
+
+inline int sizeToBucket(size_t size) {
+    int b = 0;
+    size_t s = 16;
+    while ((s < size) && (b < HeapStats::BUCKETS - 1)) {
+        s <<= 1;
+        b++;
+    }
+    return b;
+}
+
+inline size_t usableSize(void *p) {
+    Arena *a = owner(p);
+    return a ? blockSize(a, p) : malloc_usable_size(p);
+}
+
+// Called with this core's IRQs disabled
+void noteCaller(uint32_t pc, size_t size) {
+    HeapStats::Site *spare = nullptr;
+    if (!_site && !_siteFailed) {
+        // Can't call into the heap while holding a spinlock, so allocate first and discard if the other core won
+        uint32_t n = 16;
+        while (n < heap_stats_callers) {
+            n <<= 1;
+        }
+        spare = (HeapStats::Site *)__real_calloc(n, sizeof(HeapStats::Site));
+        _siteFailed = !spare;
+        uint32_t save = spin_lock_blocking(remoteLock());
+        if (!_site && spare) {
+            _siteMask = n - 1;
+            __dmb();
+            _site = spare;
+            spare = nullptr;
+        }
+        spin_unlock(remoteLock(), save);
+        __real_free(spare);
+    }
+    uint32_t save = spin_lock_blocking(remoteLock());
+    if (_site) {
+        uint32_t h = (pc >> 1) * 2654435761u;
+        int i;
+        for (i = 0; i < 8; i++) {
+            HeapStats::Site *s = &_site[((h >> 16) + i) & _siteMask];
+            if (!s->pc) {
+                s->pc = pc;
+            }
+            if (s->pc == pc) {
+                s->allocs++;
+                s->bytes += size;
+                break;
+            }
+        }
+        if (i == 8) {
+            _siteDropped++;
+        }
+    }
+    spin_unlock(remoteLock(), save);
+}
+
+// Called with this core's IRQs disabled
+void noteAlloc(void *p, void *caller) {
+    CoreStats *s = &_stats[get_core_num()];
+    if (!p) {
+        s->failed++;
+        return;
+    }
+    size_t size = usableSize(p);
+    HeapStats::Bucket *b = &s->bucket[sizeToBucket(size)];
+    b->allocs++;
+    b->live++;
+    s->used += size;
+    uint32_t total = _stats[0].used + _stats[1].used;
+    if (total > s->peak) {
+        s->peak = total;
+    }
+    if (heap_stats_callers) {
+        noteCaller((uint32_t)caller & ~1, size);
+    }
+}
+
+// Called with this core's IRQs disabled.  newlib allocates some blocks internally (strdup,
+// stdio buffers...) without going through malloc(), so the caller may free blocks which were
+// never counted.  Those can't be told apart, but never let them take the totals below 0
+void noteFree(size_t size) {
+    int b = sizeToBucket(size);
+    if ((_stats[0].bucket[b].live + _stats[1].bucket[b].live <= 0) || (_stats[0].used + _stats[1].used < (int32_t)size)) {
+        return;
+    }
+    CoreStats *s = &_stats[get_core_num()];
+    s->bucket[b].live--;
+    s->used -= size;
+}
+
+// Called with this core's IRQs disabled
+void *allocate(size_t size) {
+    void *rc = nullptr;
+    if (percore_heap_cache && (size <= MAX_SMALL)) {
+        rc = arenaAlloc(size);
+    }
+    if (!rc) {
+        rc = __real_malloc(size);
+    }
+    return rc;
+}
+
+// For operator new, which passes in its own caller so C++ allocations aren't all attributed to it
+void *allocateFor(size_t size, void *caller) {
+    noInterrupts();
+    void *rc = allocate(size ? size : 1);
+    noteAlloc(rc, caller);
+    interrupts();
+    return rc;
+}
+
+void *newFor(size_t size, void *caller) {
+    void *rc;
+    while (!(rc = allocateFor(size, caller))) {
+        std::new_handler h = std::get_new_handler();
+        if (!h) {
+            std::__throw_bad_alloc(); // Aborts unless exceptions are enabled
+        }
+        h();
+    }
+    return rc;
+}
+
+}; // namespace
 
 extern "C" void *__wrap_malloc(size_t size) {
     noInterrupts();
-    void *rc = __real_malloc(size);
+    void *rc = allocate(size);
+    noteAlloc(rc, __builtin_return_address(0));
     interrupts();
     return rc;
 }
 
 extern "C" void *__wrap_calloc(size_t count, size_t size) {
     noInterrupts();
-    void *rc = __real_calloc(count, size);
+    void *rc = nullptr;
+    if (percore_heap_cache && size && (count <= MAX_SMALL / size)) {
+        rc = arenaAlloc(count * size);
+        if (rc) {
+            memset(rc, 0, count * size);
+        }
+    }
+    if (!rc) {
+        rc = __real_calloc(count, size);
+    }
+    noteAlloc(rc, __builtin_return_address(0));
     interrupts();
     return rc;
 }
 
 extern "C" void *__wrap_realloc(void *mem, size_t size) {
     noInterrupts();
-    void *rc = __real_realloc(mem, size);
+    void *rc;
+    size_t was = mem ? usableSize(mem) : 0;
+    Arena *a = mem ? owner(mem) : nullptr;
+    if (!a) {
+        rc = __real_realloc(mem, size);
+    } else if (size && (size <= blockSize(a, mem))) {
+        rc = mem; // Still fits in the same block
+    } else {
+        rc = size ? allocate(size) : nullptr;
+        if (rc || !size) {
+            if (rc) {
+                memcpy(rc, mem, blockSize(a, mem));
+            }
+            arenaFree(a, mem);
+        }
+    }
+    if (rc || !size) {
+        // The old block is gone, and any new one counts as a fresh allocation
+        if (mem) {
+            noteFree(was);
+        }
+        if (rc) {
+            noteAlloc(rc, __builtin_return_address(0));
+        }
+    } else {
+        _stats[get_core_num()].failed++;
+    }
     interrupts();
     return rc;
 }
 
 extern "C" void __wrap_free(void *mem) {
     noInterrupts();
-    __real_free(mem);
+    Arena *a = mem ? owner(mem) : nullptr;
+    if (mem) {
+        noteFree(a ? blockSize(a, mem) : malloc_usable_size(mem));
+    }
+    if (a) {
+        arenaFree(a, mem);
+    } else {
+        __real_free(mem);
+    }
+    interrupts();
+}
+
+// Replace libstdc++'s operator new, which would otherwise be the only caller heap_stats_callers sees.
+// operator delete still ends up in free()
+void *operator new(size_t size) {
+    return newFor(size, __builtin_return_address(0));
+}
+
+void *operator new[](size_t size) {
+    return newFor(size, __builtin_return_address(0));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocateFor(size, __builtin_return_address(0));
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocateFor(size, __builtin_return_address(0));
+}
+
+size_t HeapStats::used() {
+    return _stats[0].used + _stats[1].used;
+}
+
+size_t HeapStats::peak() {
+    return max(_stats[0].peak, _stats[1].peak);
+}
+
+void HeapStats::resetPeak() {
+    noInterrupts();
+    _stats[0].peak = used();
+    _stats[1].peak = 0;
     interrupts();
 }
+
+uint32_t HeapStats::failed() {
+    return _stats[0].failed + _stats[1].failed;
+}
+
+size_t HeapStats::bucketSize(int b) {
+    return (b < BUCKETS - 1) ? 16 << b : SIZE_MAX;
+}
+
+HeapStats::Bucket HeapStats::bucket(int b) {
+    return { _stats[0].bucket[b].allocs + _stats[1].bucket[b].allocs, _stats[0].bucket[b].live + _stats[1].bucket[b].live };
+}
+
+size_t HeapStats::maxFreeBlock() {
+    // newlib can't tell us directly, so binary search for the biggest allocation which succeeds.
+    // Holding the heap lock keeps the other core from changing things in between tries
+    noInterrupts();
+    __malloc_lock(_REENT);
+    size_t lo = 0;
+    size_t hi = rp2040.getTotalHeap();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        void *p = __real_malloc(mid);
+        if (p) {
+            __real_free(p);
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    __malloc_unlock(_REENT);
+    interrupts();
+    return lo;
+}
+
+int HeapStats::fragmentation() {
+    size_t freeHeap = rp2040.getFreeHeap();
+    if (!freeHeap) {
+        return 0;
+    }
+    return 100 - (int)((uint64_t)maxFreeBlock() * 100 / freeHeap);
+}
+
+int HeapStats::sites(Site *s, int n) {
+    if (!_site) {
+        return 0;
+    }
+    // Simple selection of the top N, this is only for reports
+    int cnt = 0;
+    uint32_t lastAllocs = UINT32_MAX;
+    uint32_t lastPC = 0;
+    while (cnt < n) {
+        int best = -1;
+        for (uint32_t i = 0; i <= _siteMask; i++) {
+            Site *t = &_site[i];
+            if (!t->pc) {
+                continue;
+            }
+            // Strictly after the last one returned, ordered by allocs then PC
+            bool after = (t->allocs < lastAllocs) || ((t->allocs == lastAllocs) && (t->pc > lastPC));
+            if (after && ((best < 0) || (t->allocs > _site[best].allocs) || ((t->allocs == _site[best].allocs) && (t->pc < _site[best].pc)))) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        s[cnt++] = _site[best];
+        lastAllocs = _site[best].allocs;
+        lastPC = _site[best].pc;
+    }
+    return cnt;
+}
+
+void HeapStats::resetSites() {
+    if (!_site) {
+        return;
+    }
+    noInterrupts();
+    uint32_t save = spin_lock_blocking(remoteLock());
+    memset(_site, 0, (_siteMask + 1) * sizeof(Site));
+    _siteDropped = 0;
+    spin_unlock(remoteLock(), save);
+    interrupts();
+}
+
+void HeapStats::report(Print &p, int topSites) {
+    size_t largest = maxFreeBlock();
+    size_t freeHeap = rp2040.getFreeHeap();
+    p.printf("Heap: %u used, %u peak, %u free, %u largest free block (%d%% fragmented), %lu failed\n",
+             used(), peak(), freeHeap, largest, freeHeap ? 100 - (int)((uint64_t)largest * 100 / freeHeap) : 0, failed());
+    p.printf("  Size     Allocs     Live\n");
+    for (int i = 0; i < BUCKETS; i++) {
+        Bucket b = bucket(i);
+        if (!b.allocs) {
+            continue;
+        }
+        if (i < BUCKETS - 1) {
+            p.printf("  <=%-5u %8lu %8ld\n", bucketSize(i), b.allocs, b.live);
+        } else {
+            p.printf("  >%-6u %8lu %8ld\n", bucketSize(i - 1), b.allocs, b.live);
+        }
+    }
+    if (!_site) {
+        return;
+    }
+    Site top[32];
+    int n = sites(top, min(topSites, 32));
+    p.printf("Busiest callers (%lu not recorded):\n", _siteDropped);
+    p.printf("  Address      Allocs      Bytes\n");
+    for (int i = 0; i < n; i++) {
+        p.printf("  0x%08lx %8lu %10lu\n", top[i].pc, top[i].allocs, top[i].bytes);
+    }
+}
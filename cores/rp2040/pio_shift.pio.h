@@ -0,0 +1,59 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// --------- //
+// pio_shift //
+// --------- //
+
+#define pio_shift_wrap_target 0
+#define pio_shift_wrap 1
+
+static const uint16_t pio_shift_program_instructions[] = {
+    //     .wrap_target
+    0x6101, //  0: out    pins, 1         side 0 [1]
+    0x5101, //  1: in     pins, 1         side 1 [1]
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program pio_shift_program = {
+    .instructions = pio_shift_program_instructions,
+    .length = 2,
+    .origin = -1,
+};
+
+static inline pio_sm_config pio_shift_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + pio_shift_wrap_target, offset + pio_shift_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+
+static inline void pio_shift_program_init(PIO pio, uint sm, uint offset, uint pin_data, uint pin_clk, bool output, bool lsbFirst, float clkdiv) {
+    pio_sm_config c = pio_shift_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_data, output ? 1 : 0);
+    sm_config_set_in_pins(&c, pin_data);
+    sm_config_set_sideset_pins(&c, pin_clk);
+    sm_config_set_out_shift(&c, lsbFirst, true, 8);
+    sm_config_set_in_shift(&c, lsbFirst, true, 8);
+    sm_config_set_clkdiv(&c, clkdiv);
+
+    uint32_t mask = (1u << pin_clk) | (output ? (1u << pin_data) : 0);
+    pio_sm_set_pins_with_mask(pio, sm, 0, mask);
+    pio_sm_set_pindirs_with_mask(pio, sm, mask, (1u << pin_clk) | (1u << pin_data));
+    pio_gpio_init(pio, pin_clk);
+    if (output) {
+        pio_gpio_init(pio, pin_data);
+    }
+
+    pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif
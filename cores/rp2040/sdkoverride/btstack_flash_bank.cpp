@@ -11,6 +11,7 @@
 #include <hardware/sync.h>
 #include <string.h>
 #include <Arduino.h>
+#include <FlashBatch.h>
 
 const uint8_t __bluetooth_tlv[8192] __attribute__((aligned(4096))) = { 0 };
 extern const uint8_t __flash_binary_start;
@@ -49,11 +50,7 @@ static uint32_t pico_flash_bank_get_alignment(void * context) {
 static void pico_flash_bank_erase(void * context, int bank) {
     (void)(context);
     DEBUG_PRINT("erase: bank %d\n", bank);
-    noInterrupts();
-    rp2040.idleOtherCore();
-    flash_range_erase(PICO_FLASH_BANK_STORAGE_OFFSET + (PICO_FLASH_BANK_SIZE * bank), PICO_FLASH_BANK_SIZE);
-    rp2040.resumeOtherCore();
-    interrupts();
+    FlashBatch::eraseNow(PICO_FLASH_BANK_STORAGE_OFFSET + (PICO_FLASH_BANK_SIZE * bank), PICO_FLASH_BANK_SIZE);
 }
 
 static void pico_flash_bank_read(void *context, int bank, uint32_t offset, uint8_t *buffer, uint32_t size) {
@@ -147,11 +144,7 @@ static void pico_flash_bank_write(void * context, int bank, uint32_t offset, con
         offset = 0;
 
         // Now program the entire page
-        noInterrupts();
-        rp2040.idleOtherCore();
-        flash_range_program(bank_start_pos + (page * FLASH_PAGE_SIZE), page_data, FLASH_PAGE_SIZE);
-        rp2040.resumeOtherCore();
-        interrupts();
+        FlashBatch::programNow(bank_start_pos + (page * FLASH_PAGE_SIZE), page_data, FLASH_PAGE_SIZE);
     }
 }
 
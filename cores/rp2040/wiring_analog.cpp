@@ -25,44 +25,78 @@
 #include <hardware/clocks.h>
 #include <hardware/pll.h>
 #include <hardware/adc.h>
+#include <hardware/dma.h>
 
 void __clearADCPin(pin_size_t p);
 
 static uint32_t analogScale = 255;
 static uint32_t analogFreq = 1000;
-static uint32_t pwmInitted = 0;
-static bool scaleInitted = false;
 static bool adcInitted = false;
-static uint16_t analogWritePseudoScale = 1;
-static uint16_t analogWriteSlowScale = 1;
+
+// Each PWM slice can have its own frequency and range, or follow the global analogWriteFreq/Range
+typedef struct {
+    uint32_t freq;      // 0 = use analogFreq
+    uint32_t range;     // 0 = use analogScale
+    uint32_t top;       // Actual counter range after any rescaling
+    int8_t shift;       // Applied to analogWrite values to match top
+    bool initted;
+    int dma;            // Waveform playback channel, or -1
+    int ctrlDMA;        // Reloads the playback channel when repeating, or -1
+    const void *buf;    // Read by ctrlDMA to restart the waveform
+} PWMSlice;
+static PWMSlice _slice[NUM_PWM_SLICES] = {
+    { 0, 0, 0, 0, false, -1, -1, nullptr }, { 0, 0, 0, 0, false, -1, -1, nullptr },
+    { 0, 0, 0, 0, false, -1, -1, nullptr }, { 0, 0, 0, 0, false, -1, -1, nullptr },
+    { 0, 0, 0, 0, false, -1, -1, nullptr }, { 0, 0, 0, 0, false, -1, -1, nullptr },
+    { 0, 0, 0, 0, false, -1, -1, nullptr }, { 0, 0, 0, 0, false, -1, -1, nullptr }
+};
 
 auto_init_mutex(_dacMutex);
 
-extern "C" void analogWriteFreq(uint32_t freq) {
-    if (freq == analogFreq) {
-        return;
-    }
+static uint32_t _checkFreq(uint32_t freq) {
     if (freq < 100) {
         DEBUGCORE("ERROR: analogWriteFreq too low (%lu)\n", freq);
-        analogFreq = 100;
+        return 100;
     } else if (freq > 10'000'000) {
         DEBUGCORE("ERROR: analogWriteFreq too high (%lu)\n", freq);
-        analogFreq = 10'000'000;
-    } else {
-        analogFreq = freq;
+        return 10'000'000;
     }
-    pwmInitted = 0;
-    scaleInitted = false;
+    return freq;
+}
+
+// Global changes only affect slices without their own settings
+static void _resetSlices() {
+    for (int i = 0; i < NUM_PWM_SLICES; i++) {
+        if (!_slice[i].freq || !_slice[i].range) {
+            _slice[i].initted = false;
+        }
+    }
+}
+
+extern "C" void analogWriteFreq(uint32_t freq) {
+    CoreMutex m(&_dacMutex);
+    if (!m) {
+        return;
+    }
+    freq = _checkFreq(freq);
+    if (freq == analogFreq) {
+        return;
+    }
+    analogFreq = freq;
+    _resetSlices();
 }
 
 extern "C" void analogWriteRange(uint32_t range) {
+    CoreMutex m(&_dacMutex);
+    if (!m) {
+        return;
+    }
     if (range == analogScale) {
         return;
     }
     if ((range >= 3) && (range <= 65535)) {
         analogScale = range;
-        pwmInitted = 0;
-        scaleInitted = false;
+        _resetSlices();
     } else {
         DEBUGCORE("ERROR: analogWriteRange out of range (%lu)\n", range);
     }
@@ -76,52 +110,194 @@ extern "C" void analogWriteResolution(int res) {
     }
 }
 
-extern "C" void analogWrite(pin_size_t pin, int val) {
+// Both pins of a slice share the frequency and range
+void analogWritePinFreq(pin_size_t pin, uint32_t freq) {
     CoreMutex m(&_dacMutex);
+    if ((pin > 29) || !m) {
+        DEBUGCORE("ERROR: Illegal analogWritePinFreq pin (%d)\n", pin);
+        return;
+    }
+    PWMSlice *s = &_slice[pwm_gpio_to_slice_num(pin)];
+    s->freq = freq ? _checkFreq(freq) : 0;
+    s->initted = false;
+}
 
+void analogWritePinRange(pin_size_t pin, uint32_t range) {
+    CoreMutex m(&_dacMutex);
     if ((pin > 29) || !m) {
-        DEBUGCORE("ERROR: Illegal analogWrite pin (%d)\n", pin);
+        DEBUGCORE("ERROR: Illegal analogWritePinRange pin (%d)\n", pin);
         return;
     }
-    __clearADCPin(pin);
-    if (!scaleInitted) {
-        // For low frequencies, we need to scale the output max value up to achieve lower periods
-        analogWritePseudoScale = 1;
-        while (((clock_get_hz(clk_sys) / ((float)analogScale * analogFreq)) > 255.0) && (analogScale < 32678)) {
-            analogWritePseudoScale++;
-            analogScale *= 2;
-            DEBUGCORE("Adjusting analogWrite values PS=%d, scale=%lu\n", analogWritePseudoScale, analogScale);
-        }
-        // For high frequencies, we need to scale the output max value down to actually hit the frequency target
-        analogWriteSlowScale = 1;
-        while (((clock_get_hz(clk_sys) / ((float)analogScale * analogFreq)) < 1.0) && (analogScale >= 6)) {
-            analogWriteSlowScale++;
-            analogScale /= 2;
-            DEBUGCORE("Adjusting analogWrite values SS=%d, scale=%lu\n", analogWriteSlowScale, analogScale);
+    if (range && ((range < 3) || (range > 65535))) {
+        DEBUGCORE("ERROR: analogWritePinRange out of range (%lu)\n", range);
+        return;
+    }
+    PWMSlice *s = &_slice[pwm_gpio_to_slice_num(pin)];
+    s->range = range;
+    s->initted = false;
+}
+
+// Must be called with _dacMutex held
+static PWMSlice *_initSlice(pin_size_t pin) {
+    uint slice = pwm_gpio_to_slice_num(pin);
+    PWMSlice *s = &_slice[slice];
+    if (s->initted) {
+        return s;
+    }
+    uint32_t freq = s->freq ? s->freq : analogFreq;
+    uint32_t top = s->range ? s->range : analogScale;
+    uint32_t sys = clock_get_hz(clk_sys);
+    s->shift = 0;
+    // For low frequencies, we need to scale the output max value up to achieve lower periods
+    while ((sys / ((float)top * freq) > 255.0f) && (top < 32768)) {
+        s->shift++;
+        top *= 2;
+        DEBUGCORE("Adjusting analogWrite values for slice %d, shift=%d, scale=%lu\n", slice, s->shift, top);
+    }
+    // For high frequencies, we need to scale the output max value down to actually hit the frequency target
+    while ((sys / ((float)top * freq) < 1.0f) && (top >= 6)) {
+        s->shift--;
+        top /= 2;
+        DEBUGCORE("Adjusting analogWrite values for slice %d, shift=%d, scale=%lu\n", slice, s->shift, top);
+    }
+    s->top = top;
+
+    // Integer 8.4 divider, computed once here instead of on every write
+    uint64_t div16 = ((uint64_t)sys * 16 + ((uint64_t)top * freq) / 2) / ((uint64_t)top * freq);
+    if (div16 < 16) {
+        div16 = 16;
+    } else if (div16 > 255 * 16 + 15) {
+        div16 = 255 * 16 + 15;
+    }
+    pwm_config c = pwm_get_default_config();
+    pwm_config_set_clkdiv_int_frac(&c, div16 >> 4, div16 & 15);
+    pwm_config_set_wrap(&c, top - 1);
+    pwm_init(slice, &c, true);
+    s->initted = true;
+    return s;
+}
+
+// Must be called with _dacMutex held
+static void _stopWaveform(PWMSlice *s) {
+    if (s->dma >= 0) {
+        dma_channel_config c;
+        if (s->ctrlDMA >= 0) {
+            // Break the chain first so the control channel can't restart playback
+            c = dma_get_channel_config(s->dma);
+            channel_config_set_chain_to(&c, s->dma);
+            dma_channel_set_config(s->dma, &c, false);
+            dma_channel_abort(s->ctrlDMA);
+            dma_channel_unclaim(s->ctrlDMA);
+            s->ctrlDMA = -1;
         }
-        scaleInitted = true;
+        dma_channel_abort(s->dma);
+        dma_channel_unclaim(s->dma);
+        s->dma = -1;
     }
-    if (!(pwmInitted & (1 << pwm_gpio_to_slice_num(pin)))) {
-        pwm_config c = pwm_get_default_config();
-        pwm_config_set_clkdiv(&c, clock_get_hz(clk_sys) / ((float)analogScale * analogFreq));
-        pwm_config_set_wrap(&c, analogScale - 1);
-        pwm_init(pwm_gpio_to_slice_num(pin), &c, true);
-        pwmInitted |= 1 << pwm_gpio_to_slice_num(pin);
+}
+
+extern "C" void analogWrite(pin_size_t pin, int val) {
+    CoreMutex m(&_dacMutex);
+
+    if ((pin > 29) || !m) {
+        DEBUGCORE("ERROR: Illegal analogWrite pin (%d)\n", pin);
+        return;
     }
+    __clearADCPin(pin);
+    PWMSlice *s = _initSlice(pin);
+    _stopWaveform(s);
 
-    val <<= analogWritePseudoScale;
-    val >>= analogWriteSlowScale;
+    if (s->shift > 0) {
+        val <<= s->shift;
+    } else {
+        val >>= -s->shift;
+    }
 
     if (val < 0) {
         val = 0;
-    } else if ((uint32_t)val > analogScale) {
-        val = analogScale;
+    } else if ((uint32_t)val > s->top) {
+        val = s->top;
     }
 
     gpio_set_function(pin, GPIO_FUNC_PWM);
     pwm_set_gpio_level(pin, val);
 }
 
+bool analogWriteWaveform(pin_size_t pin, const uint16_t *levels, size_t count, bool repeat) {
+    CoreMutex m(&_dacMutex);
+
+    if ((pin > 29) || !m || !levels || !count) {
+        DEBUGCORE("ERROR: Illegal analogWriteWaveform pin (%d)\n", pin);
+        return false;
+    }
+    __clearADCPin(pin);
+    uint slice = pwm_gpio_to_slice_num(pin);
+    PWMSlice *s = _initSlice(pin);
+    _stopWaveform(s);
+    if (s->shift) {
+        DEBUGCORE("WARNING: analogWriteWaveform levels are raw, 0...%lu for this frequency\n", s->top);
+    }
+
+    s->dma = dma_claim_unused_channel(false);
+    if (repeat) {
+        s->ctrlDMA = dma_claim_unused_channel(false);
+    }
+    if ((s->dma < 0) || (repeat && (s->ctrlDMA < 0))) {
+        DEBUGCORE("ERROR: analogWriteWaveform unable to claim DMA\n");
+        if (s->dma >= 0) {
+            dma_channel_unclaim(s->dma);
+        }
+        if (s->ctrlDMA >= 0) {
+            dma_channel_unclaim(s->ctrlDMA);
+        }
+        s->dma = -1;
+        s->ctrlDMA = -1;
+        return false;
+    }
+    s->buf = levels;
+
+    // One new level every PWM period.  16-bit writes are replicated across CC, so the other
+    // pin of the slice (if it's set to PWM) will follow the same waveform
+    dma_channel_config c = dma_channel_get_default_config(s->dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pwm_get_dreq(slice));
+    if (repeat) {
+        channel_config_set_chain_to(&c, s->ctrlDMA);
+    }
+    dma_channel_configure(s->dma, &c, &pwm_hw->slice[slice].cc, levels, count, false);
+
+    if (repeat) {
+        // Rewrites the playback channel's read address, which retriggers it
+        c = dma_channel_get_default_config(s->ctrlDMA);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, false);
+        dma_channel_configure(s->ctrlDMA, &c, &dma_hw->ch[s->dma].al3_read_addr_trig, &s->buf, 1, false);
+    }
+
+    gpio_set_function(pin, GPIO_FUNC_PWM);
+    dma_channel_start(s->dma);
+    return true;
+}
+
+bool analogWriteWaveformBusy(pin_size_t pin) {
+    if (pin > 29) {
+        return false;
+    }
+    PWMSlice *s = &_slice[pwm_gpio_to_slice_num(pin)];
+    return (s->dma >= 0) && ((s->ctrlDMA >= 0) || dma_channel_is_busy(s->dma));
+}
+
+void analogWriteWaveformStop(pin_size_t pin) {
+    CoreMutex m(&_dacMutex);
+    if ((pin > 29) || !m) {
+        return;
+    }
+    _stopWaveform(&_slice[pwm_gpio_to_slice_num(pin)]);
+}
+
 auto_init_mutex(_adcMutex);
 static uint8_t _readBits = 10;
 static uint8_t _lastADCMux = 0;
@@ -131,16 +307,179 @@ void __clearADCPin(pin_size_t p) {
     _adcGPIOInit &= ~(1 << p);
 }
 
-extern "C" int analogRead(pin_size_t pin) {
+// Background sampler:  The ADC free-runs in round-robin over the selected channels and
+// one DMA channel fills a buffer of the last N samples of each.  A second channel resets
+// the write address at the end of the buffer, so slot K is always channel (K % count).
+static bool _bgRunning = false;
+static uint32_t _bgMask = 0;
+static int _bgCount = 0;
+static int _bgAverage = 1;
+static int8_t _bgSlot[5];           // First buffer slot for ADC input N, or -1
+static uint16_t *_bgBuff = nullptr;
+static void *_bgBuffAddr = nullptr; // Read by the control DMA
+static int _bgDMA = -1;
+static int _bgCtrlDMA = -1;
+
+// 48MHz / (1 + 65535.996), rounded up
+static constexpr int ADC_MIN_TOTAL_HZ = 733;
+
+static inline int _scaleADC(uint32_t v) {
+    return (_readBits < 12) ? v >> (12 - _readBits) : v << (_readBits - 12);
+}
+
+// Average of the most recent samples of one ADC input.  Called with _adcMutex held so
+// analogReadBackgroundEnd() can't free the buffer underneath it
+static uint32_t _bgRead(int input) {
+    uint32_t sum = 0;
+    for (int i = 0; i < _bgAverage; i++) {
+        sum += _bgBuff[_bgSlot[input] + i * _bgCount];
+    }
+    return (sum + _bgAverage / 2) / _bgAverage;
+}
+
+bool analogReadBackground(uint32_t channelMask, uint32_t hz, int average) {
+    CoreMutex m(&_adcMutex);
+    if (!m || _bgRunning) {
+        return false;
+    }
+    channelMask &= 0x1f;
+    if (!channelMask || !hz || (average < 1) || (average > 256)) {
+        DEBUGCORE("ERROR: Illegal analogReadBackground parameters\n");
+        return false;
+    }
+    // The ADC clock divider's integer part is only 16 bits
+    if ((uint64_t)hz * __builtin_popcount(channelMask) < ADC_MIN_TOTAL_HZ) {
+        DEBUGCORE("ERROR: analogReadBackground rate too low, minimum total is %d samples/second\n", ADC_MIN_TOTAL_HZ);
+        return false;
+    }
+    _bgDMA = dma_claim_unused_channel(false);
+    _bgCtrlDMA = dma_claim_unused_channel(false);
+    if ((_bgDMA < 0) || (_bgCtrlDMA < 0)) {
+        DEBUGCORE("ERROR: analogReadBackground unable to claim DMA\n");
+        if (_bgDMA >= 0) {
+            dma_channel_unclaim(_bgDMA);
+        }
+        if (_bgCtrlDMA >= 0) {
+            dma_channel_unclaim(_bgCtrlDMA);
+        }
+        _bgDMA = -1;
+        _bgCtrlDMA = -1;
+        return false;
+    }
+    _bgMask = channelMask;
+    _bgCount = __builtin_popcount(channelMask);
+    _bgAverage = average;
+    _bgBuff = new uint16_t[_bgCount * average];
+    _bgBuffAddr = _bgBuff;
+
+    if (!adcInitted) {
+        adc_init();
+        adcInitted = true;
+    }
+    int slot = 0;
+    for (int i = 0; i < 5; i++) {
+        if (channelMask & (1 << i)) {
+            _bgSlot[i] = slot++;
+            if (i < 4) {
+                adc_gpio_init(26 + i);
+                _adcGPIOInit |= 1 << (26 + i);
+            }
+        } else {
+            _bgSlot[i] = -1;
+        }
+    }
+    adc_set_temp_sensor_enabled(channelMask & (1 << 4));
+    // Round robin starts with the current input, so begin at the lowest one to keep the slots in order
+    adc_select_input(__builtin_ctz(channelMask));
+    _lastADCMux = 0xff;
+    adc_set_round_robin(channelMask);
+    adc_fifo_setup(true, true, 1, false, false);
+    // Each conversion is at least 96 clocks of the 48MHz ADC clock
+    float div = 48000000.0f / ((float)hz * _bgCount) - 1.0f;
+    adc_set_clkdiv(div < 0.0f ? 0.0f : div);
+
+    // Prime the buffer so reads before the first full pass are sane
+    adc_fifo_drain();
+    for (int i = 0; i < 5; i++) {
+        if (_bgSlot[i] >= 0) {
+            adc_select_input(i);
+            uint16_t v = adc_read();
+            for (int j = 0; j < average; j++) {
+                _bgBuff[_bgSlot[i] + j * _bgCount] = v;
+            }
+        }
+    }
+    adc_select_input(__builtin_ctz(channelMask));
+    adc_fifo_drain();
+
+    dma_channel_config c = dma_channel_get_default_config(_bgDMA);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, DREQ_ADC);
+    channel_config_set_chain_to(&c, _bgCtrlDMA);
+    dma_channel_configure(_bgDMA, &c, _bgBuff, &adc_hw->fifo, _bgCount * average, true);
+
+    c = dma_channel_get_default_config(_bgCtrlDMA);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(_bgCtrlDMA, &c, &dma_hw->ch[_bgDMA].al2_write_addr_trig, &_bgBuffAddr, 1, false);
+
+    adc_run(true);
+    _bgRunning = true;
+    return true;
+}
+
+void analogReadBackgroundEnd() {
     CoreMutex m(&_adcMutex);
+    if (!m || !_bgRunning) {
+        return;
+    }
+    _bgRunning = false;
+    adc_run(false);
+    // Break the chain so the control channel can't restart anything
+    dma_channel_config c = dma_get_channel_config(_bgDMA);
+    channel_config_set_chain_to(&c, _bgDMA);
+    dma_channel_set_config(_bgDMA, &c, false);
+    dma_channel_abort(_bgCtrlDMA);
+    dma_channel_abort(_bgDMA);
+    dma_channel_unclaim(_bgCtrlDMA);
+    dma_channel_unclaim(_bgDMA);
+    _bgDMA = -1;
+    _bgCtrlDMA = -1;
+    while (!(adc_hw->cs & ADC_CS_READY_BITS)) {
+        /* noop */
+    }
+    adc_set_round_robin(0);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+    adc_set_temp_sensor_enabled(false);
+    delete[] _bgBuff;
+    _bgBuff = nullptr;
+    _bgBuffAddr = nullptr;
+}
 
+extern "C" int analogRead(pin_size_t pin) {
     pin_size_t maxPin = max(A0, A3);
     pin_size_t minPin = min(A0, A3);
 
-    if ((pin < minPin) || (pin > maxPin) || !m) {
+    if ((pin < minPin) || (pin > maxPin)) {
         DEBUGCORE("ERROR: Illegal analogRead pin (%d)\n", pin);
         return 0;
     }
+    CoreMutex m(&_adcMutex);
+    if (!m) {
+        return 0;
+    }
+    // Background sampler already has it, no need to convert
+    if (_bgRunning && (_bgSlot[pin - minPin] >= 0)) {
+        return _scaleADC(_bgRead(pin - minPin));
+    }
+    if (_bgRunning) {
+        DEBUGCORE("ERROR: analogRead pin (%d) not in the background sampler\n", pin);
+        return 0;
+    }
     if (!adcInitted) {
         adc_init();
         adcInitted = true;
@@ -153,25 +492,34 @@ extern "C" int analogRead(pin_size_t pin) {
         adc_select_input(pin - minPin);
         _lastADCMux = pin;
     }
-    return (_readBits < 12) ? adc_read() >> (12 - _readBits) : adc_read() << (_readBits - 12);
+    return _scaleADC(adc_read());
 }
 
 extern "C" float analogReadTemp(float vref) {
+    int v;
     CoreMutex m(&_adcMutex);
 
     if (!m) {
         return 0.0f; // Deadlock
     }
-    if (!adcInitted) {
-        adc_init();
-        adcInitted = true;
+    if (_bgRunning && (_bgSlot[4] >= 0)) {
+        v = _bgRead(4);
+    } else {
+        if (_bgRunning) {
+            DEBUGCORE("ERROR: analogReadTemp not in the background sampler\n");
+            return 0.0f;
+        }
+        if (!adcInitted) {
+            adc_init();
+            adcInitted = true;
+        }
+        _lastADCMux = 0;
+        adc_set_temp_sensor_enabled(true);
+        delay(1); // Allow things to settle.  Without this, readings can be erratic
+        adc_select_input(4); // Temperature sensor
+        v = adc_read();
+        adc_set_temp_sensor_enabled(false);
     }
-    _lastADCMux = 0;
-    adc_set_temp_sensor_enabled(true);
-    delay(1); // Allow things to settle.  Without this, readings can be erratic
-    adc_select_input(4); // Temperature sensor
-    int v = adc_read();
-    adc_set_temp_sensor_enabled(false);
     float t = 27.0f - ((v * vref / 4096.0f) - 0.706f) / 0.001721f; // From the datasheet
     return t;
 }
@@ -115,3 +115,28 @@ extern "C" PinStatus __digitalRead(pin_size_t ulPin) {
     }
     return gpio_get(ulPin) ? HIGH : LOW;
 }
+
+// Port-wide calls go straight to the SIO set/clr/xor registers, so all
+// pins in the mask change in a single cycle with no per-pin checks
+static constexpr uint32_t _portMask = (1UL << 30) - 1;
+
+extern "C" void digitalWritePort(uint32_t mask, uint32_t value) {
+    // Toggle only the bits that differ, which updates the whole port glitch-free
+    sio_hw->gpio_togl = (sio_hw->gpio_out ^ value) & mask & _portMask;
+}
+
+extern "C" void digitalSetPort(uint32_t mask) {
+    sio_hw->gpio_set = mask & _portMask;
+}
+
+extern "C" void digitalClearPort(uint32_t mask) {
+    sio_hw->gpio_clr = mask & _portMask;
+}
+
+extern "C" void digitalTogglePort(uint32_t mask) {
+    sio_hw->gpio_togl = mask & _portMask;
+}
+
+extern "C" uint32_t digitalReadPort() {
+    return sio_hw->gpio_in & _portMask;
+}
@@ -21,8 +21,9 @@
 #include <Arduino.h>
 #include <CoreMutex.h>
 #include <hardware/gpio.h>
+#include <hardware/irq.h>
 #include <hardware/sync.h>
-#include <map>
+#include <hardware/timer.h>
 
 // Support nested IRQ disable/re-enable
 #define maxIRQs 15
@@ -49,106 +50,213 @@ extern "C" void noInterrupts() {
 }
 
 // Only 1 GPIO IRQ callback for all pins, so we need to look at the pin it's for and
-// dispatch to the real callback manually
-auto_init_mutex(_irqMutex);
-class CBInfo {
-public:
-    CBInfo(voidFuncPtr cb) : _cb(cb), _useParam(false), _param(nullptr) { };
-    CBInfo(voidFuncPtrParam cbParam, void *param) : _cbParam(cbParam), _useParam(true), _param(param) { };
-    void callback() {
-        if (_useParam && _cbParam) {
-            _cbParam(_param);
-        } else if (_cb) {
-            _cb();
-        }
-    }
-private:
-    union {
-        voidFuncPtr _cb;
-        voidFuncPtrParam _cbParam;
-    };
-    bool _useParam;
-    void *_param;
-};
+// dispatch to the real callback manually.  The table is fixed-size and indexed by pin
+// so the IRQ never needs to take a lock.  Each entry is protected by a sequence count
+// which is odd while the entry is being written, so a dispatcher running on the other
+// core simply retries instead of seeing a half-updated entry.
+auto_init_mutex(_irqMutex); // Only serializes writers, never taken in the IRQ
+enum { IRQ_NONE = 0, IRQ_CB, IRQ_CBPARAM, IRQ_QUEUE };
+typedef struct {
+    volatile uint32_t seq;
+    volatile uint8_t type;
+    void * volatile cb;
+    void * volatile param;
+} GPIOIRQEntry;
+static GPIOIRQEntry _irqTable[30];
+static volatile bool _irqCoreReady[2] = { false, false };
 
+// Edge event queues, 1 per core so each has a single producer (that core's IRQ)
+#ifndef GPIO_EVENT_QUEUE_SIZE
+#define GPIO_EVENT_QUEUE_SIZE 64 // Must be a power of 2
+#endif
+typedef struct {
+    GPIOEvent ev[GPIO_EVENT_QUEUE_SIZE];
+    volatile uint32_t head; // Written only by the IRQ
+    volatile uint32_t tail; // Written only by the reader
+    volatile uint32_t dropped;
+} GPIOEventQueue;
+static GPIOEventQueue _eventQueue[2];
 
-static std::map<pin_size_t, CBInfo> _map;
-
-void _gpioInterruptDispatcher(uint gpio, uint32_t events) {
-    (void) events;
-    // Only need to lock around the std::map check, not the whole IRQ callback
-    CoreMutex m(&_irqMutex);
-    if (m) {
-        auto irq = _map.find(gpio);
-        if (irq != _map.end()) {
-            auto cb = irq->second;
-            cb.callback();
-        }
+static void __not_in_flash_func(_queueEvent)(uint gpio, uint32_t events) {
+    GPIOEventQueue *q = &_eventQueue[get_core_num()];
+    uint32_t h = q->head;
+    if (h - q->tail >= GPIO_EVENT_QUEUE_SIZE) {
+        q->dropped = q->dropped + 1;
+        return;
+    }
+    GPIOEvent *e = &q->ev[h & (GPIO_EVENT_QUEUE_SIZE - 1)];
+    e->time = time_us_32();
+    e->pin = gpio;
+    if ((events & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)) == (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)) {
+        e->mode = CHANGE; // Both edges since the last IRQ, i.e. a glitch
+    } else if (events & GPIO_IRQ_EDGE_RISE) {
+        e->mode = RISING;
+    } else if (events & GPIO_IRQ_EDGE_FALL) {
+        e->mode = FALLING;
+    } else {
+        e->mode = (events & GPIO_IRQ_LEVEL_HIGH) ? HIGH : LOW;
     }
+    __dmb();
+    q->head = h + 1;
 }
 
-// To be called when appropriately protected w/IRQ and mutex protects
-static void _detachInterruptInternal(pin_size_t pin) {
-    auto irq = _map.find(pin);
-    if (irq != _map.end()) {
-        gpio_set_irq_enabled(pin, 0x0f /* all */, false);
-        _map.erase(pin);
+void __not_in_flash_func(_gpioInterruptDispatcher)(uint gpio, uint32_t events) {
+    if (gpio > 29) {
+        return;
+    }
+    GPIOIRQEntry *e = &_irqTable[gpio];
+    uint32_t seq;
+    uint8_t type;
+    void *cb;
+    void *param;
+    do {
+        seq = e->seq;
+        __dmb();
+        type = e->type;
+        cb = e->cb;
+        param = e->param;
+        __dmb();
+    } while ((seq & 1) || (seq != e->seq));
+
+    switch (type) {
+    case IRQ_CB:      ((voidFuncPtr)cb)(); break;
+    case IRQ_CBPARAM: ((voidFuncPtrParam)cb)(param); break;
+    case IRQ_QUEUE:   _queueEvent(gpio, events); break;
+    default:          break;
     }
 }
 
-extern "C" void attachInterrupt(pin_size_t pin, voidFuncPtr callback, PinStatus mode) {
-    CoreMutex m(&_irqMutex);
-    if (!m) {
+// Called on each core before setup()/setup1() so IRQs can be routed to either one, or by the
+// first attach on a core before then (e.g. from a global constructor or initVariant())
+void __initGPIOInterrupts() {
+    if (_irqCoreReady[get_core_num()]) {
         return;
     }
+    gpio_set_irq_callback(_gpioInterruptDispatcher);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    _irqCoreReady[get_core_num()] = true;
+}
 
-    uint32_t events;
-    switch (mode) {
-    case LOW:     events = 1; break;
-    case HIGH:    events = 2; break;
-    case FALLING: events = 4; break;
-    case RISING:  events = 8; break;
-    case CHANGE:  events = 4 | 8; break;
-    default:      return;  // ERROR
+extern void __executorRun(bool block) __attribute__((weak));
+
+// The SDK only touches the calling core's enables, so go to the HW directly
+static void _setIRQEnables(pin_size_t pin, int core, uint32_t events, bool enable) {
+    io_irq_ctrl_hw_t *ctrl = core ? &iobank0_hw->proc1_irq_ctrl : &iobank0_hw->proc0_irq_ctrl;
+    io_rw_32 *inte = &ctrl->inte[pin / 8];
+    events <<= 4 * (pin % 8);
+    if (enable) {
+        hw_set_bits(inte, events);
+    } else {
+        hw_clear_bits(inte, events);
     }
-    noInterrupts();
-    _detachInterruptInternal(pin);
-    CBInfo cb(callback);
-    _map.insert({pin, cb});
-    gpio_set_irq_enabled_with_callback(pin, events, true, _gpioInterruptDispatcher);
-    interrupts();
 }
 
-void attachInterruptParam(pin_size_t pin, voidFuncPtrParam callback, PinStatus mode, void *param) {
-    CoreMutex m(&_irqMutex);
-    if (!m) {
+// Atomically replace a table entry and (re)route it to the requested core
+static void _setInterrupt(pin_size_t pin, uint8_t type, void *cb, void *param, PinStatus mode, int core) {
+    if (pin > 29) {
+        DEBUGCORE("ERROR: Illegal pin in attachInterrupt (%d)\n", pin);
+        return;
+    }
+    uint32_t events = 0;
+    if (type != IRQ_NONE) {
+        switch (mode) {
+        case LOW:     events = GPIO_IRQ_LEVEL_LOW; break;
+        case HIGH:    events = GPIO_IRQ_LEVEL_HIGH; break;
+        case FALLING: events = GPIO_IRQ_EDGE_FALL; break;
+        case RISING:  events = GPIO_IRQ_EDGE_RISE; break;
+        case CHANGE:  events = GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE; break;
+        default:      return;  // ERROR
+        }
+    }
+    if (core < 0) {
+        core = get_core_num();
+    }
+    if ((type != IRQ_NONE) && (core == (int)get_core_num())) {
+        __initGPIOInterrupts();
+    }
+    // Core 1 may still be starting up if this is called from setup()
+    if ((core == 1) && (setup1 || loop1 || __executorRun)) {
+        uint32_t start = millis();
+        while (!_irqCoreReady[1] && (millis() - start < 100)) {
+            /* noop */
+        }
+    }
+    if ((core > 1) || ((type != IRQ_NONE) && !_irqCoreReady[core])) {
+        DEBUGCORE("ERROR: Core %d not available for GPIO interrupts\n", core);
         return;
     }
 
-    uint32_t events;
-    switch (mode) {
-    case LOW:     events = 1; break;
-    case HIGH:    events = 2; break;
-    case FALLING: events = 4; break;
-    case RISING:  events = 8; break;
-    case CHANGE:  events = 4 | 8; break;
-    default:      return;  // ERROR
+    CoreMutex m(&_irqMutex);
+    if (!m) {
+        return;
     }
     noInterrupts();
-    _detachInterruptInternal(pin);
-    CBInfo cb(callback, param);
-    _map.insert({pin, cb});
-    gpio_set_irq_enabled_with_callback(pin, events, true, _gpioInterruptDispatcher);
+    GPIOIRQEntry *e = &_irqTable[pin];
+    _setIRQEnables(pin, 0, 0x0f /* all */, false);
+    _setIRQEnables(pin, 1, 0x0f /* all */, false);
+    e->seq = e->seq + 1;
+    __dmb();
+    e->type = type;
+    e->cb = cb;
+    e->param = param;
+    __dmb();
+    e->seq = e->seq + 1;
+    if (events) {
+        gpio_acknowledge_irq(pin, events);
+        _setIRQEnables(pin, core, events, true);
+    }
     interrupts();
 }
 
+extern "C" void attachInterrupt(pin_size_t pin, voidFuncPtr callback, PinStatus mode) {
+    _setInterrupt(pin, IRQ_CB, (void *)callback, nullptr, mode, -1);
+}
+
+void attachInterruptParam(pin_size_t pin, voidFuncPtrParam callback, PinStatus mode, void *param) {
+    _setInterrupt(pin, IRQ_CBPARAM, (void *)callback, param, mode, -1);
+}
+
+void attachInterruptCore(pin_size_t pin, voidFuncPtr callback, PinStatus mode, int core) {
+    _setInterrupt(pin, IRQ_CB, (void *)callback, nullptr, mode, core);
+}
+
+void attachInterruptParamCore(pin_size_t pin, voidFuncPtrParam callback, PinStatus mode, void *param, int core) {
+    _setInterrupt(pin, IRQ_CBPARAM, (void *)callback, param, mode, core);
+}
+
+void attachInterruptEvent(pin_size_t pin, PinStatus mode, int core) {
+    _setInterrupt(pin, IRQ_QUEUE, nullptr, nullptr, mode, core);
+}
+
 extern "C" void detachInterrupt(pin_size_t pin) {
-    CoreMutex m(&_irqMutex);
-    if (!m) {
-        return;
+    _setInterrupt(pin, IRQ_NONE, nullptr, nullptr, LOW, -1);
+}
+
+// Returns the oldest event from either core's queue.  Only 1 reader at a time is supported
+bool readInterruptEvent(GPIOEvent *ev) {
+    GPIOEventQueue *q = nullptr;
+    for (int i = 0; i < 2; i++) {
+        GPIOEventQueue *c = &_eventQueue[i];
+        if (c->head != c->tail) {
+            if (!q || ((int32_t)(c->ev[c->tail & (GPIO_EVENT_QUEUE_SIZE - 1)].time - q->ev[q->tail & (GPIO_EVENT_QUEUE_SIZE - 1)].time) < 0)) {
+                q = c;
+            }
+        }
+    }
+    if (!q) {
+        return false;
     }
+    __dmb();
+    *ev = q->ev[q->tail & (GPIO_EVENT_QUEUE_SIZE - 1)];
+    __dmb();
+    q->tail = q->tail + 1;
+    return true;
+}
 
-    noInterrupts();
-    _detachInterruptInternal(pin);
-    interrupts();
+int availableInterruptEvents() {
+    return (_eventQueue[0].head - _eventQueue[0].tail) + (_eventQueue[1].head - _eventQueue[1].tail);
+}
+
+uint32_t droppedInterruptEvents() {
+    return _eventQueue[0].dropped + _eventQueue[1].dropped;
 }
@@ -20,6 +20,11 @@
 */
 
 #include <Arduino.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+#include "pio_shift.pio.h"
+
+static PIOProgram _shiftPgm(&pio_shift_program);
 
 extern "C" uint8_t shiftIn(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder) {
     uint8_t value = 0;
@@ -65,3 +70,116 @@ extern "C" void shiftOut(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOr
         digitalWrite(clockPin, LOW);
     }
 }
+
+// Shared PIO+DMA engine for shiftOutBuffer/shiftInBuffer.  The TX side always runs
+// to generate the clock, and the RX side always runs so the SM never stalls
+static void _shiftBuffer(bool output, pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, const uint8_t *tx, uint8_t *rx, size_t len, uint32_t hz) {
+    if (dataPin > 29) {
+        DEBUGCORE("ERROR: Illegal dataPin in shift%sBuffer (%d)\n", output ? "Out" : "In", dataPin);
+        return;
+    }
+    if (clockPin > 29) {
+        DEBUGCORE("ERROR: Illegal clockPin in shift%sBuffer (%d)\n", output ? "Out" : "In", clockPin);
+        return;
+    }
+    if (!len || !hz) {
+        return;
+    }
+    PIO pio;
+    int sm, off;
+    if (!_shiftPgm.prepare(&pio, &sm, &off)) {
+        DEBUGCORE("ERROR: Unable to allocate PIO for shift%sBuffer\n", output ? "Out" : "In");
+        return;
+    }
+    bool lsbFirst = bitOrder == LSBFIRST;
+    float clkdiv = (float)clock_get_hz(clk_sys) / (4.0f * hz);
+    if (clkdiv < 1.0f) {
+        clkdiv = 1.0f;
+    } else if (clkdiv > 65535.0f) {
+        clkdiv = 65535.0f;
+    }
+    pio_shift_program_init(pio, sm, off, dataPin, clockPin, output, lsbFirst, clkdiv);
+    pio_sm_set_enabled(pio, sm, true);
+
+    // 8-bit FIFO writes are replicated to all byte lanes, but reads need the lane autopush filled
+    io_rw_8 *txfifo = (io_rw_8 *)&pio->txf[sm];
+    io_rw_8 *rxfifo = (io_rw_8 *)&pio->rxf[sm] + (lsbFirst ? 3 : 0);
+    static uint8_t dummy = 0;
+
+    int txDMA = dma_claim_unused_channel(false);
+    int rxDMA = dma_claim_unused_channel(false);
+    if ((txDMA >= 0) && (rxDMA >= 0)) {
+        dma_channel_config c = dma_channel_get_default_config(rxDMA);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, !output);
+        channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+        dma_channel_configure(rxDMA, &c, output ? &dummy : rx, rxfifo, len, false);
+
+        c = dma_channel_get_default_config(txDMA);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+        channel_config_set_read_increment(&c, output);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pio_get_dreq(pio, sm, true));
+        dma_channel_configure(txDMA, &c, txfifo, output ? tx : &dummy, len, false);
+
+        dma_start_channel_mask((1u << txDMA) | (1u << rxDMA));
+        // RX completes only after the last bit has been clocked
+        dma_channel_wait_for_finish_blocking(rxDMA);
+    } else {
+        DEBUGCORE("shift%sBuffer: No DMA available, using CPU\n", output ? "Out" : "In");
+        size_t txCnt = 0;
+        size_t rxCnt = 0;
+        while (rxCnt < len) {
+            if ((txCnt < len) && !pio_sm_is_tx_fifo_full(pio, sm)) {
+                *txfifo = output ? tx[txCnt] : 0;
+                txCnt++;
+            }
+            if (!pio_sm_is_rx_fifo_empty(pio, sm)) {
+                uint8_t d = *rxfifo;
+                if (!output) {
+                    rx[rxCnt] = d;
+                }
+                rxCnt++;
+            }
+        }
+    }
+    if (txDMA >= 0) {
+        dma_channel_unclaim(txDMA);
+    }
+    if (rxDMA >= 0) {
+        dma_channel_unclaim(rxDMA);
+    }
+
+    // The SM is stalled with the clock low, hand the pins back to the SIO in the same state
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_unclaim(pio, sm);
+    gpio_put(clockPin, 0);
+    gpio_set_dir(clockPin, true);
+    gpio_set_function(clockPin, GPIO_FUNC_SIO);
+    if (output) {
+        gpio_put(dataPin, tx[len - 1] & (lsbFirst ? 0x80 : 0x01));
+        gpio_set_dir(dataPin, true);
+        gpio_set_function(dataPin, GPIO_FUNC_SIO);
+    }
+}
+
+extern "C" void shiftOutBuffer(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, const void *buf, size_t len, uint32_t hz, pin_size_t latchPin) {
+    _shiftBuffer(true, dataPin, clockPin, bitOrder, (const uint8_t *)buf, nullptr, len, hz);
+    // 74HC595 style, transfer the shift register to the outputs on a rising edge
+    if (latchPin <= 29) {
+        pinMode(latchPin, OUTPUT);
+        digitalWrite(latchPin, HIGH);
+        digitalWrite(latchPin, LOW);
+    }
+}
+
+extern "C" void shiftInBuffer(pin_size_t dataPin, pin_size_t clockPin, BitOrder bitOrder, void *buf, size_t len, uint32_t hz, pin_size_t latchPin) {
+    // 74HC165 style, load the parallel inputs while low and then shift while high
+    if (latchPin <= 29) {
+        pinMode(latchPin, OUTPUT);
+        digitalWrite(latchPin, LOW);
+        digitalWrite(latchPin, HIGH);
+    }
+    _shiftBuffer(false, dataPin, clockPin, bitOrder, nullptr, (uint8_t *)buf, len, hz);
+}
@@ -22,6 +22,7 @@
 #include <Arduino.h>
 #include <hardware/dma.h>
 #include <hardware/irq.h>
+#include <CoreTrace.h>
 #include "AudioBufferManager.h"
 
 static int                 __channelCount = 0;    // # of channels left.  When we hit 0, then remove our handler
@@ -268,6 +269,7 @@ void __not_in_flash_func(AudioBufferManager::_dmaIRQ)(int channel) {
     }
     dma_channel_set_trans_count(channel, _wordsPerBuffer * (_dmaSize == DMA_SIZE_16 ? 2 : 1), false);
     dma_channel_acknowledge_irq0(channel);
+    CORE_TRACE(CORE_TRACE_AUDIO_IRQ, channel, _overunderflow);
     if (_callback) {
         _callback();
     }
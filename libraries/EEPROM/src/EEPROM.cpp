@@ -24,6 +24,7 @@
 #include "EEPROM.h"
 #include <hardware/flash.h>
 #include <hardware/sync.h>
+#include <FlashBatch.h>
 
 #ifdef USE_TINYUSB
 // For Serial when selecting TinyUSB.  Can't include in the core because Arduino IDE
@@ -118,12 +119,15 @@ bool EEPROMClass::commit() {
         return false;
     }
 
-    noInterrupts();
-    rp2040.idleOtherCore();
-    flash_range_erase((intptr_t)_sector - (intptr_t)XIP_BASE, 4096);
-    flash_range_program((intptr_t)_sector - (intptr_t)XIP_BASE, _data, _size);
-    rp2040.resumeOtherCore();
-    interrupts();
+    // Erase and rewrite in a single park of the other core
+    FlashBatch b;
+    if (!b.erase((intptr_t)_sector - (intptr_t)XIP_BASE, 4096) ||
+            !b.program((intptr_t)_sector - (intptr_t)XIP_BASE, _data, _size)) {
+        // Don't leave the sector erased with nothing written back
+        b.clear();
+        return false;
+    }
+    b.commit();
     _dirty = false;
 
     return true;
@@ -0,0 +1,48 @@
+// Measures the cost of taking and releasing a CoreMutex, which guards Serial,
+// SPI, Wire, the ADC and more.  Build once as-is to time the FreeRTOS
+// semaphores, then comment out the FreeRTOS include and build again to time
+// the bare metal Pico SDK mutexes.
+//
+// 64 different mutexes are used, more than older cores could map to FreeRTOS.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <FreeRTOS.h>
+#include <CoreMutex.h>
+
+const int MUTEXES = 64;
+const int ROUNDS = 10000;
+
+mutex_t mtx[MUTEXES];
+
+uint32_t timeOne(mutex_t *m) {
+  uint32_t start = rp2040.getCycleCount();
+  for (int i = 0; i < ROUNDS; i++) {
+    CoreMutex cm(m);
+  }
+  return (rp2040.getCycleCount() - start) / ROUNDS;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  for (int i = 0; i < MUTEXES; i++) {
+    mutex_init(&mtx[i]);
+  }
+}
+
+void loop() {
+  // First use creates the mapping, later uses only look it up
+  uint32_t start = rp2040.getCycleCount();
+  for (int i = 0; i < MUTEXES; i++) {
+    CoreMutex cm(&mtx[i]);
+    if (!cm) {
+      Serial.printf("Mutex %d could not be taken!\n", i);
+    }
+  }
+  uint32_t all = (rp2040.getCycleCount() - start) / MUTEXES;
+
+  Serial.printf("%s: first mutex %lu cycles, last mutex %lu cycles, sweep of all %lu cycles per take/release\n",
+                __isFreeRTOS ? "FreeRTOS" : "Bare metal", timeOne(&mtx[0]), timeOne(&mtx[MUTEXES - 1]), all);
+  delay(1000);
+}
@@ -7,7 +7,9 @@
 #define configUSE_MINIMAL_IDLE_HOOK       1
 #define configUSE_TICK_HOOK               1
 #define configCPU_CLOCK_HZ                ( ( unsigned long ) F_CPU  )
+#ifndef configTICK_RATE_HZ
 #define configTICK_RATE_HZ                ( ( TickType_t ) 1000 )
+#endif
 #define configMAX_PRIORITIES              ( 8 )
 #define configMINIMAL_STACK_SIZE          ( ( unsigned short ) 256 )
 #define configTOTAL_HEAP_SIZE             ( ( size_t ) ( 164 * 1024 ) )
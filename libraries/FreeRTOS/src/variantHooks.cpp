@@ -54,6 +54,10 @@ extern "C" {
         return xSemaphoreCreateRecursiveMutex();
     }
 
+    void __freertos_mutex_delete(SemaphoreHandle_t mtx) {
+        vSemaphoreDelete(mtx);
+    }
+
     void __freertos_mutex_take(SemaphoreHandle_t mtx) {
         xSemaphoreTake(mtx, portMAX_DELAY);
     }
@@ -96,6 +100,21 @@ extern "C" {
 
 /*-----------------------------------------------------------*/
 
+// Override these in the sketch to tune the tasks the core creates.  Stacks are in 32-bit words
+uint32_t freertos_loop_stack __attribute__((weak)) = 1024;
+uint32_t freertos_loop_priority __attribute__((weak)) = configMAX_PRIORITIES / 2;
+uint32_t freertos_loop1_stack __attribute__((weak)) = 1024;
+uint32_t freertos_loop1_priority __attribute__((weak)) = configMAX_PRIORITIES / 2;
+uint32_t freertos_usb_stack __attribute__((weak)) = 256;
+uint32_t freertos_usb_priority __attribute__((weak)) = configMAX_PRIORITIES - 2;
+
+// Rounds up, so never sleeps for 0 ticks when the tick is slower than 1ms.  portTICK_PERIOD_MS
+// is an integer and can't be used here, it's 0 above 1kHz and truncated for rates not dividing 1000
+static inline TickType_t __msToTicks(unsigned long ms) {
+    uint64_t ticks = ((uint64_t)ms * configTICK_RATE_HZ + 999) / 1000;
+    return (ticks > portMAX_DELAY) ? portMAX_DELAY : (TickType_t)ticks;
+}
+
 extern void __initFreeRTOSMutexes();
 void initFreeRTOS(void) {
     __initFreeRTOSMutexes();
@@ -105,8 +124,10 @@ extern void setup() __attribute__((weak));
 extern void loop() __attribute__((weak));
 extern void setup1() __attribute__((weak));
 extern void loop1() __attribute__((weak));
+extern void __executorRun(bool block) __attribute__((weak));
 // Idle functions (USB, events, ...) from the core
 extern void __loop();
+extern void __initGPIOInterrupts();
 volatile bool __usbInitted = false;
 
 static void __core0(void *params) {
@@ -116,6 +137,7 @@ static void __core0(void *params) {
         delay(1);
     }
 #endif
+    __initGPIOInterrupts();
     if (setup) {
         setup();
     }
@@ -138,13 +160,21 @@ static void __core1(void *params) {
         delay(1);
     }
 #endif
+    // Protects this core's IRQ (MSP) stack, tasks have their own
+    rp2040._guardStack();
+    __initGPIOInterrupts();
     if (setup1) {
         setup1();
     }
     if (loop1) {
         while (1) {
             loop1();
+            if (__executorRun) {
+                __executorRun(false);
+            }
         }
+    } else if (__executorRun) {
+        __executorRun(true);
     } else {
         while (1) {
             vTaskDelay(1000);
@@ -153,7 +183,7 @@ static void __core1(void *params) {
 }
 
 extern "C" void delay(unsigned long ms) {
-    vTaskDelay(ms / portTICK_PERIOD_MS);
+    vTaskDelay(__msToTicks(ms));
 }
 
 extern "C" void yield() {
@@ -167,9 +197,12 @@ static void __no_inline_not_in_flash_func(IdleThisCore)(void *param) {
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         vTaskPreemptionDisable(nullptr);
         portDISABLE_INTERRUPTS();
+        void (*cb)() = __parkedCallback[sio_hw->cpuid];
         __otherCoreIdled = true;
         while (__otherCoreIdled) {
-            /* noop */
+            if (cb) {
+                cb();
+            }
         }
         portENABLE_INTERRUPTS();
         vTaskPreemptionEnable(nullptr);
@@ -201,12 +234,12 @@ extern volatile bool __freeRTOSinitted;
 void startFreeRTOS(void) {
 
     TaskHandle_t c0;
-    xTaskCreate(__core0, "CORE0", 1024, 0, configMAX_PRIORITIES / 2, &c0);
+    xTaskCreate(__core0, "CORE0", freertos_loop_stack, 0, freertos_loop_priority, &c0);
     vTaskCoreAffinitySet(c0, 1 << 0);
 
-    if (setup1 || loop1) {
+    if (setup1 || loop1 || __executorRun) {
         TaskHandle_t c1;
-        xTaskCreate(__core1, "CORE1", 1024, 0, configMAX_PRIORITIES / 2, &c1);
+        xTaskCreate(__core1, "CORE1", freertos_loop1_stack, 0, freertos_loop1_priority, &c1);
         vTaskCoreAffinitySet(c1, 1 << 1);
     }
 
@@ -252,7 +285,9 @@ void vApplicationIdleHook(void) __attribute__((weak));
 
 
 void vApplicationIdleHook(void) {
-    __wfe(); // Low power idle if nothing to do...
+    // Low power idle until the next tick or other IRQ.  WFI instead of WFE so the
+    // SEVs sent by every spinlock and mutex release on the other core don't wake us
+    __wfi();
 }
 
 #endif /* configUSE_IDLE_HOOK == 1 */
@@ -477,7 +512,7 @@ static void __usb(void *param) {
             tud_task();
             xSemaphoreGive(m);
         }
-        vTaskDelay(1 / portTICK_PERIOD_MS);
+        vTaskDelay(__msToTicks(1));
     }
 }
 
@@ -491,6 +526,6 @@ void __USBStart() {
     __SetupUSBDescriptor();
 
     // Make high prio and locked to core 0
-    xTaskCreate(__usb, "USB", 256, 0, configMAX_PRIORITIES - 2, &__usbTask);
+    xTaskCreate(__usb, "USB", freertos_usb_stack, 0, freertos_usb_priority, &__usbTask);
     vTaskCoreAffinitySet(__usbTask, 1 << 0);
 }
@@ -26,6 +26,7 @@
 #include "LittleFS.h"
 #include <hardware/flash.h>
 #include <hardware/sync.h>
+#include <FlashBatch.h>
 
 #ifdef USE_TINYUSB
 // For Serial when selecting TinyUSB.  Can't include in the core because Arduino IDE
@@ -182,12 +183,10 @@ int LittleFSImpl::lfs_flash_prog(const struct lfs_config *c,
                                  lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size) {
     LittleFSImpl *me = reinterpret_cast<LittleFSImpl*>(c->context);
     uint8_t *addr = me->_start + (block * me->_blockSize) + off;
-    noInterrupts();
-    rp2040.idleOtherCore();
     //    Serial.printf("WRITE: %p, $d\n", (intptr_t)addr - (intptr_t)XIP_BASE, size);
-    flash_range_program((intptr_t)addr - (intptr_t)XIP_BASE, (const uint8_t *)buffer, size);
-    rp2040.resumeOtherCore();
-    interrupts();
+    if (!FlashBatch::programNow((intptr_t)addr - (intptr_t)XIP_BASE, buffer, size)) {
+        return LFS_ERR_IO;
+    }
     return 0;
 }
 
@@ -195,11 +194,9 @@ int LittleFSImpl::lfs_flash_erase(const struct lfs_config *c, lfs_block_t block)
     LittleFSImpl *me = reinterpret_cast<LittleFSImpl*>(c->context);
     uint8_t *addr = me->_start + (block * me->_blockSize);
     //    Serial.printf("ERASE: %p, %d\n", (intptr_t)addr - (intptr_t)XIP_BASE, me->_blockSize);
-    noInterrupts();
-    rp2040.idleOtherCore();
-    flash_range_erase((intptr_t)addr - (intptr_t)XIP_BASE, me->_blockSize);
-    rp2040.resumeOtherCore();
-    interrupts();
+    if (!FlashBatch::eraseNow((intptr_t)addr - (intptr_t)XIP_BASE, me->_blockSize)) {
+        return LFS_ERR_IO;
+    }
     return 0;
 }
 
@@ -0,0 +1,52 @@
+/*
+  Simple PSRAM read/write and allocation test for an APS6404 on the PIO QSPI bus
+
+  SIO0..SIO3 on GPIO 2..5, SCK on GPIO 6, CS on GPIO 7
+
+  Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+*/
+
+#include <PSRAM.h>
+
+PSRAM psram(2, 6);
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  if (!psram.begin(50'000'000)) {
+    Serial.printf("No PSRAM found\n");
+    return;
+  }
+  Serial.printf("Found %d bytes of PSRAM, %d free\n", psram.size(), psram.getFreeHeap());
+
+  // Allocate a 64KB region and fill it with a pattern
+  psram_addr_t buff = psram.malloc(65536);
+  uint32_t data[256];
+  uint32_t start = micros();
+  for (int blk = 0; blk < 64; blk++) {
+    for (int i = 0; i < 256; i++) {
+      data[i] = blk * 256 + i;
+    }
+    psram.write(buff + blk * 1024, data, sizeof(data));
+  }
+  uint32_t wr = micros() - start;
+
+  int errors = 0;
+  start = micros();
+  for (int blk = 0; blk < 64; blk++) {
+    psram.read(buff + blk * 1024, data, sizeof(data));
+    for (int i = 0; i < 256; i++) {
+      if (data[i] != (uint32_t)(blk * 256 + i)) {
+        errors++;
+      }
+    }
+  }
+  uint32_t rd = micros() - start;
+  Serial.printf("Write: %lu us, Read: %lu us, %d errors\n", wr, rd, errors);
+
+  psram.free(buff);
+  Serial.printf("Free after release: %d, largest block %d\n", psram.getFreeHeap(), psram.getLargestFreeBlock());
+}
+
+void loop() {
+}
@@ -0,0 +1,214 @@
+/*
+    External QSPI PSRAM (APS6404/ESP-PSRAM64) support for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "PSRAM.h"
+#include <CoreMutex.h>
+
+// APS6404 command set
+static constexpr uint8_t CMD_RESET_ENABLE = 0x66;
+static constexpr uint8_t CMD_RESET = 0x99;
+static constexpr uint8_t CMD_READ_ID = 0x9f;
+static constexpr uint8_t CMD_ENTER_QPI = 0x35;
+static constexpr uint8_t CMD_EXIT_QPI = 0xf5;
+static constexpr uint8_t CMD_QUAD_READ = 0xeb;
+static constexpr uint8_t CMD_QUAD_WRITE = 0x38;
+static constexpr int QUAD_READ_WAIT = 6;
+
+// Bursts wrap at 1K pages, and CS can't be low for more than 8us (refresh)
+static constexpr uint32_t PAGE_SIZE = 1024;
+static constexpr float MAX_CS_LOW = 8e-6f;
+
+PSRAM::PSRAM(pin_size_t sio0, pin_size_t sck, size_t size) : _bus(sio0, sck) {
+    _size = size;
+    _running = false;
+    _maxChunk = 0;
+    memset(_id, 0, sizeof(_id));
+    mutex_init(&_mutex);
+}
+
+PSRAM::~PSRAM() {
+    end();
+}
+
+bool PSRAM::begin(uint32_t hz) {
+    if (_running) {
+        return true;
+    }
+    if (!_bus.begin(hz)) {
+        return false;
+    }
+
+    // Chip may have been left in QPI mode by a reset, so kick it out first
+    _bus.transfer(QSPI_4_4_4, CMD_EXIT_QPI, 0, 0, 0, nullptr, nullptr, 0);
+    const uint8_t rsten = CMD_RESET_ENABLE;
+    const uint8_t rst = CMD_RESET;
+    _bus.command(&rsten, 1);
+    _bus.command(&rst, 1);
+    delayMicroseconds(200);
+
+    const uint8_t rdid[4] = { CMD_READ_ID, 0, 0, 0 };
+    _bus.command(rdid, sizeof(rdid), _id, sizeof(_id));
+    DEBUGV("PSRAM: ID = %02x %02x %02x %02x %02x %02x %02x %02x\n", _id[0], _id[1], _id[2], _id[3], _id[4], _id[5], _id[6], _id[7]);
+    // Known-good-die marker
+    if (_id[1] != 0x5d) {
+        DEBUGV("PSRAM: No PSRAM detected\n");
+        _bus.end();
+        return false;
+    }
+
+    const uint8_t qpi = CMD_ENTER_QPI;
+    _bus.command(&qpi, 1);
+
+    // Keep every transaction (command, address, wait and data) under the CS low limit.
+    // Reads are the worst case with 2 + 6 + 6 clocks of overhead, then 2 clocks/byte.
+    int clocks = (int)(MAX_CS_LOW * _bus.getClock()) - 14;
+    _maxChunk = std::max(4, clocks / 2) & ~3;
+    _maxChunk = std::min(_maxChunk, std::min(QSPIPIO::maxWrite(QSPI_4_4_4, 3), QSPIPIO::maxRead(QUAD_READ_WAIT)));
+
+    _free.clear();
+    _used.clear();
+    _free.insert({0, _size});
+    _running = true;
+    DEBUGV("PSRAM: %d bytes, chunk size %d\n", _size, _maxChunk);
+    return true;
+}
+
+void PSRAM::end() {
+    if (!_running) {
+        return;
+    }
+    _bus.transfer(QSPI_4_4_4, CMD_EXIT_QPI, 0, 0, 0, nullptr, nullptr, 0);
+    _bus.end();
+    _running = false;
+}
+
+// Split into pieces which don't cross a page and keep CS low time legal
+void PSRAM::chunked(bool isWrite, psram_addr_t addr, uint8_t *buf, size_t len) {
+    CoreMutex m(&_mutex);
+    if (!_running || !m) {
+        return;
+    }
+    while (len) {
+        size_t toPage = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+        size_t cnt = std::min(len, std::min(toPage, _maxChunk));
+        if (isWrite) {
+            _bus.transfer(QSPI_4_4_4, CMD_QUAD_WRITE, addr, 3, 0, buf, nullptr, cnt);
+        } else {
+            _bus.transfer(QSPI_4_4_4, CMD_QUAD_READ, addr, 3, QUAD_READ_WAIT, nullptr, buf, cnt);
+        }
+        addr += cnt;
+        buf += cnt;
+        len -= cnt;
+    }
+}
+
+void PSRAM::read(psram_addr_t addr, void *buf, size_t len) {
+    chunked(false, addr, (uint8_t *)buf, len);
+}
+
+void PSRAM::write(psram_addr_t addr, const void *buf, size_t len) {
+    chunked(true, addr, (uint8_t *)buf, len);
+}
+
+psram_addr_t PSRAM::malloc(size_t size) {
+    CoreMutex m(&_mutex);
+    if (!_running || !size || !m) {
+        return INVALID;
+    }
+    size = (size + 3) & ~3;
+    for (auto f = _free.begin(); f != _free.end(); f++) {
+        if (f->second >= size) {
+            psram_addr_t addr = f->first;
+            size_t left = f->second - size;
+            _free.erase(f);
+            if (left) {
+                _free.insert({addr + size, left});
+            }
+            _used.insert({addr, size});
+            return addr;
+        }
+    }
+    DEBUGV("PSRAM: Unable to allocate %d bytes\n", size);
+    return INVALID;
+}
+
+psram_addr_t PSRAM::calloc(size_t count, size_t size) {
+    if (size && (count > SIZE_MAX / size)) {
+        DEBUGV("PSRAM: calloc(%d, %d) overflows\n", count, size);
+        return INVALID;
+    }
+    psram_addr_t addr = malloc(count * size);
+    if (addr != INVALID) {
+        uint8_t zero[64];
+        memset(zero, 0, sizeof(zero));
+        for (size_t i = 0; i < count * size; i += sizeof(zero)) {
+            write(addr + i, zero, std::min(sizeof(zero), count * size - i));
+        }
+    }
+    return addr;
+}
+
+void PSRAM::free(psram_addr_t addr) {
+    CoreMutex m(&_mutex);
+    if (!m) {
+        return;
+    }
+    auto u = _used.find(addr);
+    if (u == _used.end()) {
+        DEBUGV("PSRAM: Freeing unallocated address %08lx\n", addr);
+        return;
+    }
+    psram_addr_t start = u->first;
+    size_t len = u->second;
+    _used.erase(u);
+
+    // Merge with the following and preceding free extents, if adjacent
+    auto next = _free.lower_bound(start);
+    if ((next != _free.end()) && (start + len == next->first)) {
+        len += next->second;
+        next = _free.erase(next);
+    }
+    if (next != _free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            prev->second += len;
+            return;
+        }
+    }
+    _free.insert({start, len});
+}
+
+size_t PSRAM::getFreeHeap() {
+    CoreMutex m(&_mutex);
+    size_t sum = 0;
+    for (auto f : _free) {
+        sum += f.second;
+    }
+    return sum;
+}
+
+size_t PSRAM::getLargestFreeBlock() {
+    CoreMutex m(&_mutex);
+    size_t big = 0;
+    for (auto f : _free) {
+        big = std::max(big, f.second);
+    }
+    return big;
+}
@@ -0,0 +1,74 @@
+/*
+    External QSPI PSRAM (APS6404/ESP-PSRAM64) support for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <QSPIPIO.h>
+#include <map>
+
+// The RP2040 can't memory-map a PIO-attached PSRAM, so allocations are handed
+// out as PSRAM addresses which are then used with read() and write().
+typedef uint32_t psram_addr_t;
+
+class PSRAM {
+public:
+    static const psram_addr_t INVALID = 0xffffffff;
+
+    // SIO0..SIO3 are 4 consecutive GPIOs, CS must be SCK + 1
+    PSRAM(pin_size_t sio0, pin_size_t sck, size_t size = 8 * 1024 * 1024);
+    ~PSRAM();
+
+    bool begin(uint32_t hz = 33'000'000);
+    void end();
+
+    // Raw access, any length and alignment
+    void read(psram_addr_t addr, void *buf, size_t len);
+    void write(psram_addr_t addr, const void *buf, size_t len);
+
+    // Simple first-fit heap over the entire chip
+    psram_addr_t malloc(size_t size);
+    psram_addr_t calloc(size_t count, size_t size);
+    void free(psram_addr_t addr);
+
+    size_t size() {
+        return _size;
+    }
+    size_t getFreeHeap();
+    size_t getLargestFreeBlock();
+
+    // Raw ID bytes from the chip, only valid after begin()
+    const uint8_t *getID() {
+        return _id;
+    }
+
+private:
+    void chunked(bool isWrite, psram_addr_t addr, uint8_t *buf, size_t len);
+
+    QSPIPIO _bus;
+    size_t _size;
+    bool _running;
+    size_t _maxChunk;
+    uint8_t _id[8];
+    mutex_t _mutex;
+
+    std::map<psram_addr_t, size_t> _free; // Start -> length of free extents
+    std::map<psram_addr_t, size_t> _used; // Start -> length of allocations
+};
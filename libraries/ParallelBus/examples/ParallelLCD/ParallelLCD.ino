@@ -0,0 +1,79 @@
+// Draws color bars on an 8-bit i8080 parallel LCD (ILI9341-style command set)
+// using the PIO to generate the WR strobe and DMA to move the pixels.
+// D0-D7 = GP0-GP7, WR = GP8, DC = GP9, CS = GP10, RST = GP11
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <ParallelBus.h>
+
+#define PIN_WR 8
+#define PIN_DC 9
+#define PIN_CS 10
+#define PIN_RST 11
+
+ParallelBus bus(0, 8, PIN_WR);
+
+void command(uint8_t cmd, const uint8_t *data = nullptr, size_t len = 0) {
+  bus.flush(); // All prior data must be clocked out before DC changes
+  digitalWriteFast(PIN_DC, LOW);
+  bus.write(cmd);
+  bus.flush();
+  digitalWriteFast(PIN_DC, HIGH);
+  if (len) {
+    bus.write(data, len);
+  }
+}
+
+void setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+  uint8_t col[4] = { (uint8_t)(x0 >> 8), (uint8_t)x0, (uint8_t)(x1 >> 8), (uint8_t)x1 };
+  uint8_t row[4] = { (uint8_t)(y0 >> 8), (uint8_t)y0, (uint8_t)(y1 >> 8), (uint8_t)y1 };
+  command(0x2a, col, 4);
+  command(0x2b, row, 4);
+  command(0x2c); // Memory write, pixels follow
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(PIN_DC, OUTPUT);
+  pinMode(PIN_CS, OUTPUT);
+  pinMode(PIN_RST, OUTPUT);
+  digitalWrite(PIN_CS, HIGH);
+  digitalWrite(PIN_RST, LOW);
+  delay(10);
+  digitalWrite(PIN_RST, HIGH);
+  delay(120);
+
+  bus.begin(20000000);
+  digitalWrite(PIN_CS, LOW);
+  command(0x01); // Software reset
+  delay(150);
+  command(0x11); // Sleep out
+  delay(120);
+  const uint8_t pixfmt = 0x55; // 16bpp
+  command(0x3a, &pixfmt, 1);
+  command(0x29); // Display on
+}
+
+void loop() {
+  static const uint16_t colors[] = { 0xf800, 0x07e0, 0x001f, 0xffff };
+  static uint8_t line[240 * 2];
+  uint32_t start = micros();
+  for (int bar = 0; bar < 4; bar++) {
+    setWindow(0, bar * 80, 239, bar * 80 + 79);
+    for (int i = 0; i < 240; i++) {
+      line[i * 2] = colors[bar] >> 8;
+      line[i * 2 + 1] = colors[bar] & 0xff;
+    }
+    for (int y = 0; y < 80; y++) {
+      bus.write(line, sizeof(line));
+    }
+  }
+  bus.flush();
+  Serial.printf("Frame took %lu us\n", micros() - start);
+  delay(1000);
+
+  // Clear to black using a repeated value and no buffer at all
+  setWindow(0, 0, 239, 319);
+  bus.fill(0, 240 * 320 * 2);
+  bus.flush();
+  delay(1000);
+}
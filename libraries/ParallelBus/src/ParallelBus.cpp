@@ -0,0 +1,193 @@
+/*
+    PIO + DMA parallel bus (i8080/6800) writer for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelBus.h"
+#include <CoreMutex.h>
+#include <hardware/gpio.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+#include <map>
+#include "pio_parallel.pio.h"
+
+// ------------------------------------------------------------------------
+// -- Generates a unique program for each bus width
+static std::map<int, PIOProgram*> _pgmMap;
+auto_init_mutex(_pgmMutex);
+
+// Duplicate the program and replace the first insn with an "out pins, width"
+static PIOProgram *_getProgram(int width) {
+    CoreMutex m(&_pgmMutex);
+    auto f = _pgmMap.find(width);
+    if (f == _pgmMap.end()) {
+        pio_program_t *p = new pio_program_t;
+        p->length = pio_parallel_program.length;
+        p->origin = pio_parallel_program.origin;
+        uint16_t *insn = (uint16_t *)malloc(p->length * 2);
+        if (!insn) {
+            delete p;
+            return nullptr;
+        }
+        memcpy(insn, pio_parallel_program.instructions, p->length * 2);
+        insn[0] = pio_encode_out(pio_pins, width);
+        p->instructions = insn;
+        _pgmMap.insert({width, new PIOProgram(p)});
+        f = _pgmMap.find(width);
+    }
+    return f->second;
+}
+// ------------------------------------------------------------------------
+
+ParallelBus::ParallelBus(pin_size_t d0, int width, pin_size_t strobe, Mode mode) {
+    _d0 = d0;
+    _width = width;
+    _strobe = strobe;
+    _mode = mode;
+    _running = false;
+    _pgm = nullptr;
+    _pio = nullptr;
+    _sm = -1;
+    _dma = -1;
+    _fillVal = 0;
+}
+
+ParallelBus::~ParallelBus() {
+    end();
+}
+
+bool ParallelBus::begin(uint32_t wordsPerSecond) {
+    if (_running) {
+        return true;
+    }
+    if ((_width < 1) || (_width > 16) || (_d0 + _width > 30) || (_strobe > 29) || !wordsPerSecond) {
+        DEBUGCORE("ERROR: Illegal ParallelBus configuration\n");
+        return false;
+    }
+    _pgm = _getProgram(_width);
+    int off;
+    if (!_pgm || !_pgm->prepare(&_pio, &_sm, &off)) {
+        DEBUGCORE("ERROR: Unable to allocate ParallelBus PIO, out of resources\n");
+        return false;
+    }
+    _dma = dma_claim_unused_channel(false);
+    if (_dma < 0) {
+        DEBUGCORE("ERROR: Unable to allocate ParallelBus DMA\n");
+        pio_sm_unclaim(_pio, _sm);
+        return false;
+    }
+
+    // Each word takes 3 PIO cycles
+    float clkdiv = (float)clock_get_hz(clk_sys) / (3.0f * wordsPerSecond);
+    if (clkdiv < 1.0f) {
+        clkdiv = 1.0f;
+    } else if (clkdiv > 65535.0f) {
+        clkdiv = 65535.0f;
+    }
+    pio_parallel_program_init(_pio, _sm, off, _d0, _width, _strobe, clkdiv);
+    gpio_set_outover(_strobe, (_mode == M6800) ? GPIO_OVERRIDE_INVERT : GPIO_OVERRIDE_NORMAL);
+    pio_sm_set_enabled(_pio, _sm, true);
+
+    dma_channel_config c = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&c, (_width <= 8) ? DMA_SIZE_8 : DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, true));
+    dma_channel_configure(_dma, &c, &_pio->txf[_sm], nullptr, 0, false);
+
+    _running = true;
+    return true;
+}
+
+void ParallelBus::end() {
+    if (!_running) {
+        return;
+    }
+    flush();
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_sm_unclaim(_pio, _sm);
+    dma_channel_unclaim(_dma);
+    _dma = -1;
+    gpio_set_outover(_strobe, GPIO_OVERRIDE_NORMAL);
+    for (int i = 0; i < _width; i++) {
+        gpio_set_function(_d0 + i, GPIO_FUNC_SIO);
+    }
+    gpio_set_function(_strobe, GPIO_FUNC_SIO);
+    _running = false;
+}
+
+void ParallelBus::write(uint16_t val) {
+    if (!_running) {
+        return;
+    }
+    // DMA may still be feeding the FIFO, don't interleave with it
+    dma_channel_wait_for_finish_blocking(_dma);
+    while (pio_sm_is_tx_fifo_full(_pio, _sm)) {
+        /* noop */
+    }
+    if (_width <= 8) {
+        *(io_rw_8 *)&_pio->txf[_sm] = val;
+    } else {
+        *(io_rw_16 *)&_pio->txf[_sm] = val;
+    }
+}
+
+bool ParallelBus::writeAsync(const void *buf, size_t words) {
+    if (!_running || !words) {
+        return false;
+    }
+    dma_channel_wait_for_finish_blocking(_dma);
+    hw_set_bits(&dma_hw->ch[_dma].al1_ctrl, DMA_CH0_CTRL_TRIG_INCR_READ_BITS);
+    dma_channel_transfer_from_buffer_now(_dma, buf, words);
+    return true;
+}
+
+void ParallelBus::write(const void *buf, size_t words) {
+    if (writeAsync(buf, words)) {
+        dma_channel_wait_for_finish_blocking(_dma);
+    }
+}
+
+void ParallelBus::fill(uint16_t val, size_t words) {
+    if (!_running || !words) {
+        return;
+    }
+    dma_channel_wait_for_finish_blocking(_dma);
+    // Little-endian, so the same address works for 8- or 16-bit transfers
+    _fillVal = val;
+    hw_clear_bits(&dma_hw->ch[_dma].al1_ctrl, DMA_CH0_CTRL_TRIG_INCR_READ_BITS);
+    dma_channel_transfer_from_buffer_now(_dma, &_fillVal, words);
+    dma_channel_wait_for_finish_blocking(_dma);
+}
+
+bool ParallelBus::busy() {
+    return _running && dma_channel_is_busy(_dma);
+}
+
+void ParallelBus::flush() {
+    if (!_running) {
+        return;
+    }
+    dma_channel_wait_for_finish_blocking(_dma);
+    // Once the SM stalls on an empty FIFO, the last word has been strobed
+    uint32_t stallMask = 1u << (PIO_FDEBUG_TXSTALL_LSB + _sm);
+    _pio->fdebug = stallMask;
+    while (!(_pio->fdebug & stallMask)) {
+        /* noop */
+    }
+}
@@ -0,0 +1,71 @@
+/*
+    PIO + DMA parallel bus (i8080/6800) writer for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/pio.h>
+
+class ParallelBus {
+public:
+    typedef enum {
+        I8080, // Active-low WR strobe, latched on rising edge
+        M6800  // Active-high E strobe, latched on falling edge (R/W tied low)
+    } Mode;
+
+    // Data pins are width (1..16) consecutive GPIOs starting at d0
+    ParallelBus(pin_size_t d0, int width, pin_size_t strobe, Mode mode = I8080);
+    ~ParallelBus();
+
+    // Rate is in bus words per second, up to F_CPU / 3
+    bool begin(uint32_t wordsPerSecond = 10'000'000);
+    void end();
+
+    // Single word, only blocks if the FIFO is full
+    void write(uint16_t val);
+
+    // Block of words (uint8_t for width <= 8, uint16_t otherwise).  Blocks until complete
+    void write(const void *buf, size_t words);
+
+    // Starts a DMA of the block and returns immediately.  Buffer must remain valid until !busy()
+    bool writeAsync(const void *buf, size_t words);
+
+    // Repeat a single value, i.e. for clearing a display.  Blocks until complete
+    void fill(uint16_t val, size_t words);
+
+    // True while a DMA is still running
+    bool busy();
+
+    // Wait until every word has actually been strobed out, i.e. before changing DC/CS
+    void flush();
+
+private:
+    pin_size_t _d0;
+    int _width;
+    pin_size_t _strobe;
+    Mode _mode;
+    bool _running;
+
+    PIOProgram *_pgm;
+    PIO _pio;
+    int _sm;
+    int _dma;
+    uint16_t _fillVal;
+};
@@ -0,0 +1,59 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------------ //
+// pio_parallel //
+// ------------ //
+
+#define pio_parallel_wrap_target 0
+#define pio_parallel_wrap 2
+
+static const uint16_t pio_parallel_program_instructions[] = {
+    //     .wrap_target
+    0x6008, //  0: out    pins, 8
+    0xb042, //  1: nop                    side 0
+    0xb842, //  2: nop                    side 1
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program pio_parallel_program = {
+    .instructions = pio_parallel_program_instructions,
+    .length = 3,
+    .origin = -1,
+};
+
+static inline pio_sm_config pio_parallel_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + pio_parallel_wrap_target, offset + pio_parallel_wrap);
+    sm_config_set_sideset(&c, 2, true, false);
+    return c;
+}
+
+static inline void pio_parallel_program_init(PIO pio, uint sm, uint offset, uint pin_d0, uint bits, uint pin_wr, float clkdiv) {
+    pio_sm_config c = pio_parallel_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_d0, bits);
+    sm_config_set_sideset_pins(&c, pin_wr);
+    sm_config_set_out_shift(&c, true, true, bits);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv(&c, clkdiv);
+
+    uint32_t mask = (((1u << bits) - 1) << pin_d0) | (1u << pin_wr);
+    pio_sm_set_pins_with_mask(pio, sm, 1u << pin_wr, mask);
+    pio_sm_set_pindirs_with_mask(pio, sm, mask, mask);
+    for (uint i = 0; i < bits; i++) {
+        pio_gpio_init(pio, pin_d0 + i);
+    }
+    pio_gpio_init(pio, pin_wr);
+
+    pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif
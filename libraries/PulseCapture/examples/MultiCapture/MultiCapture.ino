@@ -0,0 +1,37 @@
+// Measures 3 signals at once with no CPU overhead:  a PWM output looped back
+// from GP0 to GP1, an RC receiver channel on GP2, and a fan tachometer on GP3
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <PulseCapture.h>
+
+PulseCapture pwm(1);
+PulseCapture rc(2);
+PulseCapture tach(3);
+
+void setup() {
+  Serial.begin(115200);
+  analogWriteFreq(10000);
+  analogWrite(0, 64); // 25% duty at 10KHz, connect GP0 to GP1
+
+  pinMode(3, INPUT_PULLUP); // Tach outputs are open-collector
+  pwm.begin();
+  rc.begin();
+  tach.begin();
+  tach.setTimeout(2000); // Fans can spin slowly
+}
+
+void loop() {
+  if (pwm.available()) {
+    Serial.printf("PWM: %.2f Hz, %.1f%% duty\n", pwm.frequency(), pwm.dutyCycle() * 100.0);
+  } else {
+    Serial.printf("PWM: no signal\n");
+  }
+  if (rc.available()) {
+    Serial.printf("RC: %.1f us\n", rc.pulseWidth(HIGH));
+  }
+  if (tach.available()) {
+    // 2 pulses per revolution
+    Serial.printf("Fan: %.0f RPM\n", tach.frequency() * 60.0 / 2.0);
+  }
+  delay(500);
+}
@@ -0,0 +1,243 @@
+/*
+    PIO + DMA edge capture for pulse width/period/frequency measurement
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "PulseCapture.h"
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/clocks.h>
+#include "pulse_capture.pio.h"
+
+static PIOProgram _capturePgm(&pulse_capture_program);
+
+// The DMA counts down from this and is restarted by the IRQ when it hits 0
+static constexpr uint32_t DMA_COUNT = 0xffffffff;
+
+static int _channelCount = 0;               // Remove our IRQ handler when this hits 0
+static PulseCapture *_channelMap[NUM_DMA_CHANNELS];
+
+// Time in cycles between 2 captured edges which are count edges apart.  See pulse_capture.pio
+static inline uint32_t _cyclesBetween(uint32_t older, uint32_t newer, uint32_t count) {
+    return 2 * (((older >> 1) - (newer >> 1)) & 0x7fffffff) + 3 * count;
+}
+
+PulseCapture::PulseCapture(pin_size_t pin) {
+    _pin = pin;
+    _running = false;
+    _timeoutMS = 1000;
+    _pio = nullptr;
+    _sm = -1;
+    _dma = -1;
+    _reloads = 0;
+    _lastEdge = 0;
+    _lastStamp = 0;
+    _lastEdgeCycle = 0;
+}
+
+PulseCapture::~PulseCapture() {
+    end();
+}
+
+bool PulseCapture::begin() {
+    if (_running) {
+        return true;
+    }
+    if (_pin > 29) {
+        DEBUGCORE("ERROR: Illegal pin in PulseCapture (%d)\n", _pin);
+        return false;
+    }
+    int off;
+    if (!_capturePgm.prepare(&_pio, &_sm, &off)) {
+        DEBUGCORE("ERROR: Unable to allocate PulseCapture PIO, out of resources\n");
+        return false;
+    }
+    _dma = dma_claim_unused_channel(false);
+    if (_dma < 0) {
+        DEBUGCORE("ERROR: Unable to allocate PulseCapture DMA\n");
+        pio_sm_unclaim(_pio, _sm);
+        return false;
+    }
+    memset(_ring, 0, sizeof(_ring));
+    _reloads = 0;
+
+    pulse_capture_program_init(_pio, _sm, off, _pin);
+
+    dma_channel_config c = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(sizeof(_ring)));
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, false));
+    channel_config_set_irq_quiet(&c, false);
+    dma_channel_configure(_dma, &c, _ring, &_pio->rxf[_sm], DMA_COUNT, true);
+
+    noInterrupts();
+    _channelMap[_dma] = this;
+    dma_channel_set_irq1_enabled(_dma, true);
+    if (!_channelCount++) {
+        irq_add_shared_handler(DMA_IRQ_1, _irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+    }
+    interrupts();
+
+    // Edge 0 is the SM starting, with X all 1s
+    _lastEdge = 0;
+    _lastStamp = 0xfffffffe;
+    _lastEdgeCycle = rp2040.getCycleCount64();
+    pio_sm_set_enabled(_pio, _sm, true);
+    _running = true;
+    return true;
+}
+
+void PulseCapture::end() {
+    if (!_running) {
+        return;
+    }
+    pio_sm_set_enabled(_pio, _sm, false);
+    noInterrupts();
+    dma_channel_set_irq1_enabled(_dma, false);
+    _channelMap[_dma] = nullptr;
+    if (!--_channelCount) {
+        irq_remove_handler(DMA_IRQ_1, _irq);
+    }
+    interrupts();
+    dma_channel_abort(_dma);
+    dma_channel_acknowledge_irq1(_dma);
+    dma_channel_unclaim(_dma);
+    _dma = -1;
+    pio_sm_unclaim(_pio, _sm);
+    _running = false;
+}
+
+// Only happens every 4 billion edges, just restart where we left off in the ring
+void __not_in_flash_func(PulseCapture::_irq)() {
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (_channelMap[i] && dma_channel_get_irq1_status(i)) {
+            dma_channel_acknowledge_irq1(i);
+            _channelMap[i]->_reloads++;
+            dma_channel_start(i);
+        }
+    }
+}
+
+uint64_t PulseCapture::edgeCount(uint32_t *transferCount) {
+    uint32_t r, c;
+    do {
+        r = _reloads;
+        c = dma_hw->ch[_dma].transfer_count;
+    } while (r != _reloads);
+    if (transferCount) {
+        *transferCount = c;
+    }
+    return (uint64_t)r * DMA_COUNT + (DMA_COUNT - c);
+}
+
+uint64_t PulseCapture::edges() {
+    return _running ? edgeCount() : 0;
+}
+
+bool PulseCapture::measure(uint32_t &high, uint32_t &low) {
+    high = 0;
+    low = 0;
+    if (!_running) {
+        return false;
+    }
+    uint32_t e[3];
+    uint64_t n1, n2;
+    uint32_t idx;
+    do {
+        n1 = edgeCount();
+        idx = (dma_hw->ch[_dma].write_addr - (uint32_t)_ring) / 4;
+        for (int i = 0; i < 3; i++) {
+            e[i] = _ring[(idx - 1 - i) & (RING - 1)];
+        }
+        n2 = edgeCount();
+        // Retry only if the DMA could have lapped the entries we just read
+    } while (n2 - n1 > RING - 4);
+    uint64_t now = rp2040.getCycleCount64();
+    // e[0] is the edge the write address had reached, the only count between n1 and n2 which ends there
+    uint64_t n = n1 + ((idx - n1) & (RING - 1));
+
+    if (n != _lastEdge) {
+        // The timestamps give the time since the last known edge, modulo 2^32 cycles.  The new
+        // edge came after the last poll, so that's exact unless polls are over 2^32 cycles apart,
+        // and then the most recent possibility is taken
+        uint64_t when = _lastEdgeCycle + _cyclesBetween(_lastStamp, e[0], (uint32_t)(n - _lastEdge));
+        while (when + (1ULL << 32) <= now) {
+            when += 1ULL << 32;
+        }
+        _lastEdge = n;
+        _lastStamp = e[0];
+        _lastEdgeCycle = min(when, now);
+    }
+    if (now - _lastEdgeCycle > (uint64_t)_timeoutMS * (clock_get_hz(clk_sys) / 1000)) {
+        return false;
+    }
+    if (n < 3) {
+        return false;
+    }
+
+    // Edges always alternate.  If the newest is a rising edge then the last complete HIGH pulse is the one before it
+    if (e[0] & 1) {
+        high = _cyclesBetween(e[2], e[1], 1);
+        low = _cyclesBetween(e[1], e[0], 1);
+    } else {
+        low = _cyclesBetween(e[2], e[1], 1);
+        high = _cyclesBetween(e[1], e[0], 1);
+    }
+    return true;
+}
+
+bool PulseCapture::available() {
+    uint32_t high, low;
+    return measure(high, low);
+}
+
+uint32_t PulseCapture::pulseCycles(PinStatus state) {
+    uint32_t high, low;
+    measure(high, low);
+    return (state == HIGH) ? high : low;
+}
+
+uint32_t PulseCapture::periodCycles() {
+    uint32_t high, low;
+    measure(high, low);
+    return high + low;
+}
+
+float PulseCapture::pulseWidth(PinStatus state) {
+    return pulseCycles(state) * 1000000.0f / clock_get_hz(clk_sys);
+}
+
+float PulseCapture::period() {
+    return periodCycles() * 1000000.0f / clock_get_hz(clk_sys);
+}
+
+float PulseCapture::frequency() {
+    uint32_t p = periodCycles();
+    return p ? (float)clock_get_hz(clk_sys) / p : 0.0f;
+}
+
+float PulseCapture::dutyCycle() {
+    uint32_t high, low;
+    if (!measure(high, low)) {
+        return 0.0f;
+    }
+    return (float)high / (high + low);
+}
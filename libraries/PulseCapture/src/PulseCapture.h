@@ -0,0 +1,84 @@
+/*
+    PIO + DMA edge capture for pulse width/period/frequency measurement
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/pio.h>
+
+// Every edge on the pin is timestamped by a PIO state machine at 2-cycle
+// resolution and written by DMA into a small ring buffer, so measurements
+// are always available immediately and no CPU time is spent capturing.
+class PulseCapture {
+public:
+    PulseCapture(pin_size_t pin);
+    ~PulseCapture();
+
+    bool begin();
+    void end();
+
+    // Results go to 0 if no edge has been seen for this long (default 1s)
+    void setTimeout(uint32_t ms) {
+        _timeoutMS = ms;
+    }
+
+    // True once a full period has been captured and the signal hasn't timed out
+    bool available();
+
+    // Last complete HIGH or LOW pulse and last full period, in system clock cycles
+    uint32_t pulseCycles(PinStatus state);
+    uint32_t periodCycles();
+
+    // Same, in microseconds
+    float pulseWidth(PinStatus state);
+    float period();
+
+    // Hz and 0.0-1.0 (fraction of the period HIGH)
+    float frequency();
+    float dutyCycle();
+
+    // Number of edges captured since begin()
+    uint64_t edges();
+
+private:
+    static constexpr int RING = 16; // Must be a power of 2, buffer aligned to its size in bytes
+
+    // Last complete HIGH and LOW pulse, from the same consistent set of edges
+    bool measure(uint32_t &high, uint32_t &low);
+    uint64_t edgeCount(uint32_t *transferCount = nullptr);
+    static void _irq();
+
+    pin_size_t _pin;
+    bool _running;
+    uint32_t _timeoutMS;
+
+    PIO _pio;
+    int _sm;
+    int _dma;
+
+    volatile uint32_t _reloads;
+
+    // Newest edge seen so far, with its time in rp2040.getCycleCount64() terms worked out from its timestamp
+    uint64_t _lastEdge;
+    uint32_t _lastStamp;
+    uint64_t _lastEdgeCycle;
+
+    alignas(RING * 4) uint32_t _ring[RING];
+};
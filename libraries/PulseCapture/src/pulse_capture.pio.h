@@ -0,0 +1,58 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------------- //
+// pulse_capture //
+// ------------- //
+
+#define pulse_capture_wrap_target 3
+#define pulse_capture_wrap 10
+
+static const uint16_t pulse_capture_program_instructions[] = {
+    0xa04b, //  0: mov    y, ~null
+    0xa02b, //  1: mov    x, ~null
+    0x00c8, //  2: jmp    pin, 8
+    //     .wrap_target
+    0x00c6, //  3: jmp    pin, 6
+    0x0043, //  4: jmp    x--, 3
+    0x0003, //  5: jmp    3
+    0x403f, //  6: in     x, 31
+    0x4041, //  7: in     y, 1
+    0x00cb, //  8: jmp    pin, 11
+    0x403f, //  9: in     x, 31
+    0x4061, // 10: in     null, 1
+    //     .wrap
+    0x0048, // 11: jmp    x--, 8
+    0x0008, // 12: jmp    8
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program pulse_capture_program = {
+    .instructions = pulse_capture_program_instructions,
+    .length = 13,
+    .origin = -1,
+};
+
+static inline pio_sm_config pulse_capture_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + pulse_capture_wrap_target, offset + pulse_capture_wrap);
+    return c;
+}
+
+static inline void pulse_capture_program_init(PIO pio, uint sm, uint offset, uint pin) {
+    pio_sm_config c = pulse_capture_program_get_default_config(offset);
+    sm_config_set_jmp_pin(&c, pin);
+    sm_config_set_in_shift(&c, false, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    sm_config_set_clkdiv(&c, 1.0f);
+    pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif
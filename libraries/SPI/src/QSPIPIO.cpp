@@ -0,0 +1,243 @@
+/*
+    PIO-based Quad/Dual-SPI bus driver for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "QSPIPIO.h"
+#include <hardware/gpio.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+#include "pio_qspi.pio.h"
+
+static PIOProgram _qspiPgm(&pio_qspi_program);
+
+// Below this many bytes it's faster to just let the CPU feed the FIFOs
+static constexpr size_t _dmaMin = 8;
+
+QSPIPIO::QSPIPIO(pin_size_t sio0, pin_size_t sck) {
+    _sio0 = sio0;
+    _sck = sck;
+    _running = false;
+    _hz = 0;
+    _pio = nullptr;
+    _sm = -1;
+    _off = 0;
+    _txDMA = -1;
+    _rxDMA = -1;
+}
+
+QSPIPIO::~QSPIPIO() {
+    end();
+}
+
+bool QSPIPIO::begin(uint32_t hz) {
+    if (_running) {
+        return true;
+    }
+    if ((_sio0 > 26) || (_sck > 28)) {
+        DEBUGSPI("QSPIPIO: Illegal pins, SIO0=%d, SCK=%d\n", _sio0, _sck);
+        return false;
+    }
+    if (!_qspiPgm.prepare(&_pio, &_sm, &_off)) {
+        DEBUGSPI("QSPIPIO: Unable to allocate PIO, out of resources\n");
+        return false;
+    }
+    // One SCK period is 2 PIO cycles
+    float clkdiv = (float)clock_get_hz(clk_sys) / (2.0f * hz);
+    if (clkdiv < 1.0f) {
+        clkdiv = 1.0f;
+    } else if (clkdiv > 65535.0f) {
+        clkdiv = 65535.0f;
+    }
+    _hz = clock_get_hz(clk_sys) / (2.0f * clkdiv);
+    pio_qspi_program_init(_pio, _sm, _off, clkdiv, _sio0, _sck);
+    pio_sm_set_enabled(_pio, _sm, true);
+
+    // DMA is optional, if we can't get the channels we'll just use the CPU
+    _txDMA = dma_claim_unused_channel(false);
+    _rxDMA = dma_claim_unused_channel(false);
+    if ((_txDMA < 0) || (_rxDMA < 0)) {
+        DEBUGSPI("QSPIPIO: Unable to claim DMA channels, using CPU transfers\n");
+        if (_txDMA >= 0) {
+            dma_channel_unclaim(_txDMA);
+        }
+        if (_rxDMA >= 0) {
+            dma_channel_unclaim(_rxDMA);
+        }
+        _txDMA = -1;
+        _rxDMA = -1;
+    }
+    _running = true;
+    DEBUGSPI("QSPIPIO::begin() pio=%d, sm=%d, clkdiv=%f, SCK=%lu\n", pio_get_index(_pio), _sm, clkdiv, _hz);
+    return true;
+}
+
+void QSPIPIO::end() {
+    if (!_running) {
+        return;
+    }
+    // Let any pending write drain out before stopping the SM
+    while (!pio_sm_is_tx_fifo_empty(_pio, _sm) || (pio_sm_get_pc(_pio, _sm) != _off + pio_qspi_wrap_target)) {
+        /* noop */
+    }
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_sm_unclaim(_pio, _sm);
+    if (_txDMA >= 0) {
+        dma_channel_unclaim(_txDMA);
+        dma_channel_unclaim(_rxDMA);
+        _txDMA = -1;
+        _rxDMA = -1;
+    }
+    for (int i = 0; i < 4; i++) {
+        gpio_set_function(_sio0 + i, GPIO_FUNC_SIO);
+    }
+    gpio_set_function(_sck, GPIO_FUNC_SIO);
+    gpio_set_function(_sck + 1, GPIO_FUNC_SIO);
+    _running = false;
+}
+
+// Expand a byte into 8 SIO0-only nibbles.  SIO2/SIO3 are held high so
+// that WP#/HOLD# on flash-like devices stay inactive
+void QSPIPIO::putSerial(uint8_t *dest, uint8_t b) {
+    for (int i = 0; i < 4; i++) {
+        uint8_t hi = 0x0c | ((b >> 7) & 1);
+        uint8_t lo = 0x0c | ((b >> 6) & 1);
+        *(dest++) = (hi << 4) | lo;
+        b <<= 2;
+    }
+}
+
+void QSPIPIO::writeFIFO(const uint8_t *p, size_t len) {
+    io_rw_8 *txfifo = (io_rw_8 *)&_pio->txf[_sm];
+    while (len--) {
+        while (pio_sm_is_tx_fifo_full(_pio, _sm)) {
+            /* noop */
+        }
+        *txfifo = *(p++);
+    }
+}
+
+void QSPIPIO::readFIFO(uint8_t *p, size_t len) {
+    io_rw_8 *rxfifo = (io_rw_8 *)&_pio->rxf[_sm];
+    while (len--) {
+        while (pio_sm_is_rx_fifo_empty(_pio, _sm)) {
+            /* noop */
+        }
+        uint8_t d = *rxfifo;
+        if (p) {
+            *(p++) = d;
+        }
+    }
+}
+
+void QSPIPIO::command(const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) {
+    if (!_running || !txLen || (txLen > 32) || (rxLen > 31)) {
+        return;
+    }
+    DEBUGSPI("QSPIPIO::command(%p, %d, %p, %d)\n", tx, txLen, rx, rxLen);
+    uint8_t hdr[2] = { (uint8_t)(txLen * 8 - 1), (uint8_t)(rxLen * 8) };
+    writeFIFO(hdr, 2);
+    for (size_t i = 0; i < txLen; i++) {
+        uint8_t exp[4];
+        putSerial(exp, tx[i]);
+        writeFIFO(exp, 4);
+    }
+    // Each received bit comes in on SIO1 of a nibble, so 4 FIFO bytes make 1 data byte
+    for (size_t i = 0; i < rxLen; i++) {
+        uint8_t raw[4];
+        readFIFO(raw, 4);
+        uint8_t b = 0;
+        for (int j = 0; j < 4; j++) {
+            b = (b << 2) | ((raw[j] >> 4) & 2) | ((raw[j] >> 1) & 1);
+        }
+        if (rx) {
+            rx[i] = b;
+        }
+    }
+}
+
+void QSPIPIO::transfer(QSPIMode mode, uint8_t cmd, uint32_t addr, int addrBytes, int dummyClocks, const void *tx, void *rx, size_t len) {
+    if (!_running || (addrBytes < 0) || (addrBytes > 4) || (dummyClocks < 0) || (dummyClocks > 16) || (dummyClocks & 1)) {
+        return;
+    }
+    const uint8_t *txbuff = reinterpret_cast<const uint8_t *>(tx);
+    uint8_t *rxbuff = reinterpret_cast<uint8_t *>(rx);
+    size_t dummyBytes = dummyClocks / 2;
+    size_t txLen = txbuff ? len : 0;
+    size_t rxLen = (rxbuff && !txbuff) ? len : 0;
+
+    uint8_t hdr[2 + 4 + 16 + 8];
+    size_t h = 2;
+    if (mode == QSPI_4_4_4) {
+        hdr[h++] = cmd;
+    } else {
+        putSerial(&hdr[h], cmd);
+        h += 4;
+    }
+    for (int i = addrBytes - 1; i >= 0; i--) {
+        uint8_t a = addr >> (8 * i);
+        if (mode == QSPI_1_1_4) {
+            putSerial(&hdr[h], a);
+            h += 4;
+        } else {
+            hdr[h++] = a;
+        }
+    }
+    if (!rxLen) {
+        // No turnaround on writes, so just drive zeros for any dummy cycles
+        memset(&hdr[h], 0, dummyBytes);
+        h += dummyBytes;
+    }
+    size_t writeBytes = h - 2 + txLen;
+    size_t readBytes = rxLen ? rxLen + dummyBytes : 0;
+    if ((writeBytes > 128) || (readBytes > 127)) {
+        DEBUGSPI("QSPIPIO::transfer too large, write=%d, read=%d\n", writeBytes, readBytes);
+        return;
+    }
+    hdr[0] = writeBytes * 2 - 1;
+    hdr[1] = readBytes * 2;
+    writeFIFO(hdr, h);
+
+    if (txLen) {
+        if ((txLen >= _dmaMin) && (_txDMA >= 0)) {
+            dma_channel_config c = dma_channel_get_default_config(_txDMA);
+            channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+            channel_config_set_read_increment(&c, true);
+            channel_config_set_write_increment(&c, false);
+            channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, true));
+            dma_channel_configure(_txDMA, &c, &_pio->txf[_sm], txbuff, txLen, true);
+            dma_channel_wait_for_finish_blocking(_txDMA);
+        } else {
+            writeFIFO(txbuff, txLen);
+        }
+    } else if (rxLen) {
+        // Wait cycles come in as garbage, toss them before any DMA starts
+        readFIFO(nullptr, dummyBytes);
+        if ((rxLen >= _dmaMin) && (_rxDMA >= 0)) {
+            dma_channel_config c = dma_channel_get_default_config(_rxDMA);
+            channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+            channel_config_set_read_increment(&c, false);
+            channel_config_set_write_increment(&c, true);
+            channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, false));
+            dma_channel_configure(_rxDMA, &c, rxbuff, &_pio->rxf[_sm], rxLen, true);
+            dma_channel_wait_for_finish_blocking(_rxDMA);
+        } else {
+            readFIFO(rxbuff, rxLen);
+        }
+    }
+}
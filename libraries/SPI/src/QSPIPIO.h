@@ -0,0 +1,82 @@
+/*
+    PIO-based Quad/Dual-SPI bus driver for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/pio.h>
+
+// Bus widths of the command, address, and data phases
+typedef enum {
+    QSPI_1_1_4, // Serial command and address, quad data (most QSPI displays)
+    QSPI_1_4_4, // Serial command, quad address and data (SPI-mode fast quad read)
+    QSPI_4_4_4  // Everything quad (QPI mode)
+} QSPIMode;
+
+class QSPIPIO {
+public:
+    // SIO0..SIO3 must be consecutive GPIOs starting at sio0, and CS must be SCK + 1
+    QSPIPIO(pin_size_t sio0, pin_size_t sck);
+    ~QSPIPIO();
+
+    bool begin(uint32_t hz = 33'000'000);
+    void end();
+
+    // Plain single-bit SPI transaction (SIO0 = MOSI, SIO1 = MISO), i.e. for
+    // resets, mode switches, and ID reads.  rxLen is limited to 31 bytes
+    void command(const uint8_t *tx, size_t txLen, uint8_t *rx = nullptr, size_t rxLen = 0);
+
+    // Command + address + optional dummy clocks, then quad data written from tx
+    // or read into rx (exactly one of which should be non-NULL).  The complete
+    // write phase is limited to 128 bytes and reads (including dummy clocks) to
+    // 127 bytes, so callers need to split longer transfers.
+    void transfer(QSPIMode mode, uint8_t cmd, uint32_t addr, int addrBytes, int dummyClocks, const void *tx, void *rx, size_t len);
+
+    // Largest data payload transfer() can handle for a given header
+    static constexpr size_t maxWrite(QSPIMode mode, int addrBytes) {
+        return 128 - hdrBytes(mode, addrBytes);
+    }
+    static constexpr size_t maxRead(int dummyClocks) {
+        return 127 - (dummyClocks / 2);
+    }
+
+    uint32_t getClock() {
+        return _hz;
+    }
+
+private:
+    static constexpr size_t hdrBytes(QSPIMode mode, int addrBytes) {
+        return (mode == QSPI_4_4_4 ? 1 : 4) + (mode == QSPI_1_1_4 ? 4 : 1) * addrBytes;
+    }
+    void putSerial(uint8_t *dest, uint8_t b);
+    void writeFIFO(const uint8_t *p, size_t len);
+    void readFIFO(uint8_t *p, size_t len);
+
+    pin_size_t _sio0, _sck;
+    bool _running;
+    uint32_t _hz;
+
+    PIO _pio;
+    int _sm;
+    int _off;
+
+    int _txDMA;
+    int _rxDMA;
+};
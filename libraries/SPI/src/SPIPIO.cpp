@@ -0,0 +1,346 @@
+/*
+    PIO-based SPI Master library for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SPIPIO.h"
+#include <hardware/gpio.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+#include <hardware/structs/iobank0.h>
+#include <hardware/irq.h>
+#include "pio_spi.pio.h"
+
+#ifdef USE_TINYUSB
+// For Serial when selecting TinyUSB.  Can't include in the core because Arduino IDE
+// will not link in libraries called from the core.  Instead, add the header to all
+// the standard libraries in the hope it will still catch some user cases where they
+// use these libraries.
+// See https://github.com/earlephilhower/arduino-pico/issues/167#issuecomment-848622174
+#include <Adafruit_TinyUSB.h>
+#endif
+
+static PIOProgram _spiCPHA0Pgm(&pio_spi_cpha0_program);
+static PIOProgram _spiCPHA1Pgm(&pio_spi_cpha1_program);
+
+SPIPIO::SPIPIO(pin_size_t rx, pin_size_t cs, pin_size_t sck, pin_size_t tx) {
+    _running = false;
+    _initted = false;
+    _spis = SPISettings(0, LSBFIRST, SPI_MODE0); // Ensure PIO set up called by setting current freq to 0
+    _RX = rx;
+    _TX = tx;
+    _SCK = sck;
+    _CS = cs;
+    _hwCS = false;
+    _pgm = nullptr;
+    _pio = nullptr;
+    _sm = -1;
+    _off = 0;
+    _cpha = false;
+    _lsb = false;
+    _txDMA = -1;
+    _rxDMA = -1;
+    _dmaThreshold = 32;
+}
+
+SPIPIO::~SPIPIO() {
+    if (_running) {
+        end();
+    }
+}
+
+inline bool SPIPIO::cpol() {
+    switch (_spis.getDataMode()) {
+    case SPI_MODE2:
+    case SPI_MODE3:
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline bool SPIPIO::cpha() {
+    switch (_spis.getDataMode()) {
+    case SPI_MODE1:
+    case SPI_MODE3:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// (Re)load the proper CPHA program and configure the SM for the current settings
+bool SPIPIO::setupPIO() {
+    bool newCPHA = cpha();
+    if (!_pgm || (newCPHA != _cpha)) {
+        releasePIO();
+        _pgm = newCPHA ? &_spiCPHA1Pgm : &_spiCPHA0Pgm;
+        if (!_pgm->prepare(&_pio, &_sm, &_off)) {
+            DEBUGSPI("SPIPIO: Unable to allocate PIO, out of resources\n");
+            _pgm = nullptr;
+            return false;
+        }
+        _cpha = newCPHA;
+    }
+    _lsb = _spis.getBitOrder() == LSBFIRST;
+    // CPHA0 needs 2 PIO cycles per bit, CPHA1 needs 4
+    float clkdiv = (float)clock_get_hz(clk_sys) / (_spis.getClockFreq() * (_cpha ? 4.0f : 2.0f));
+    if (clkdiv < 1.0f) {
+        clkdiv = 1.0f;
+    } else if (clkdiv > 65535.0f) {
+        clkdiv = 65535.0f;
+    }
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_spi_program_init(_pio, _sm, _off, _cpha, clkdiv, _lsb, _SCK, _TX, (_RX == NOPIN) ? _TX : _RX);
+    gpio_set_outover(_SCK, cpol() ? GPIO_OVERRIDE_INVERT : GPIO_OVERRIDE_NORMAL);
+    pio_sm_set_enabled(_pio, _sm, true);
+    DEBUGSPI("SPIPIO: pio=%d, sm=%d, cpha=%d, clkdiv=%f\n", pio_get_index(_pio), _sm, _cpha, clkdiv);
+    return true;
+}
+
+void SPIPIO::releasePIO() {
+    if (_pgm) {
+        pio_sm_set_enabled(_pio, _sm, false);
+        pio_sm_unclaim(_pio, _sm);
+        _pgm = nullptr;
+    }
+}
+
+byte SPIPIO::transfer(uint8_t data) {
+    uint8_t ret;
+    if (!_initted) {
+        return 0;
+    }
+    DEBUGSPI("SPIPIO::transfer(%02x)\n", data);
+    transfer(&data, &ret, 1);
+    DEBUGSPI("SPIPIO: read back %02x\n", ret);
+    return ret;
+}
+
+uint16_t SPIPIO::transfer16(uint16_t data) {
+    uint8_t tx[2], rx[2];
+    if (!_initted) {
+        return 0;
+    }
+    DEBUGSPI("SPIPIO::transfer16(%04x)\n", data);
+    // Bit order applies to the whole 16-bit word, so send the proper half first
+    if (_lsb) {
+        tx[0] = data & 0xff;
+        tx[1] = data >> 8;
+    } else {
+        tx[0] = data >> 8;
+        tx[1] = data & 0xff;
+    }
+    transfer(tx, rx, 2);
+    uint16_t ret = _lsb ? (rx[0] | (rx[1] << 8)) : ((rx[0] << 8) | rx[1]);
+    DEBUGSPI("SPIPIO: read back %04x\n", ret);
+    return ret;
+}
+
+void SPIPIO::transfer(void *buf, size_t count) {
+    DEBUGSPI("SPIPIO::transfer(%p, %d)\n", buf, count);
+    transfer(buf, buf, count);
+    DEBUGSPI("SPIPIO::transfer completed\n");
+}
+
+void SPIPIO::transfer(const void *txbuf, void *rxbuf, size_t count) {
+    if (!_initted || !count) {
+        return;
+    }
+    DEBUGSPI("SPIPIO::transfer(%p, %p, %d)\n", txbuf, rxbuf, count);
+    const uint8_t *txbuff = reinterpret_cast<const uint8_t *>(txbuf);
+    uint8_t *rxbuff = reinterpret_cast<uint8_t *>(rxbuf);
+
+    if ((count >= _dmaThreshold) && (_txDMA >= 0) && (_rxDMA >= 0)) {
+        transferDMA(txbuff, rxbuff, count);
+        return;
+    }
+
+    // 8-bit FIFO accesses are replicated on write and need the proper lane on read
+    io_rw_8 *txfifo = (io_rw_8 *)&_pio->txf[_sm];
+    io_rw_8 *rxfifo = (io_rw_8 *)&_pio->rxf[_sm] + (_lsb ? 3 : 0);
+    size_t txRemain = count;
+    size_t rxRemain = count;
+    while (txRemain || rxRemain) {
+        if (txRemain && !pio_sm_is_tx_fifo_full(_pio, _sm)) {
+            *txfifo = txbuff ? *(txbuff++) : 0xff;
+            --txRemain;
+        }
+        if (rxRemain && !pio_sm_is_rx_fifo_empty(_pio, _sm)) {
+            uint8_t d = *rxfifo;
+            if (rxbuff) {
+                *(rxbuff++) = d;
+            }
+            --rxRemain;
+        }
+    }
+    DEBUGSPI("SPIPIO::transfer completed\n");
+}
+
+void SPIPIO::transferDMA(const uint8_t *txbuf, uint8_t *rxbuf, size_t count) {
+    static uint8_t txDummy = 0xff;
+    static uint8_t rxDummy;
+
+    DEBUGSPI("SPIPIO::transferDMA(%p, %p, %d)\n", txbuf, rxbuf, count);
+    dma_channel_config c = dma_channel_get_default_config(_txDMA);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, txbuf != nullptr);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, true));
+    dma_channel_configure(_txDMA, &c, &_pio->txf[_sm], txbuf ? txbuf : &txDummy, count, false);
+
+    c = dma_channel_get_default_config(_rxDMA);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, rxbuf != nullptr);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, false));
+    dma_channel_configure(_rxDMA, &c, rxbuf ? rxbuf : &rxDummy, (io_rw_8 *)&_pio->rxf[_sm] + (_lsb ? 3 : 0), count, false);
+
+    // Start both together so the RX FIFO can never stall the SM
+    dma_start_channel_mask((1u << _txDMA) | (1u << _rxDMA));
+    dma_channel_wait_for_finish_blocking(_rxDMA);
+    DEBUGSPI("SPIPIO::transferDMA completed\n");
+}
+
+void SPIPIO::beginTransaction(SPISettings settings) {
+    noInterrupts(); // Avoid possible race conditions if IRQ comes in while main app is in middle of this
+    DEBUGSPI("SPIPIO::beginTransaction(clk=%lu, bo=%s)\n", settings.getClockFreq(), (settings.getBitOrder() == MSBFIRST) ? "MSB" : "LSB");
+    if (_initted && settings == _spis) {
+        DEBUGSPI("SPIPIO: Reusing existing initted SPI\n");
+    } else {
+        _spis = settings;
+        _initted = setupPIO();
+    }
+    if (_hwCS) {
+        digitalWrite(_CS, LOW);
+    }
+    // Disable any IRQs that are being used for SPI
+    io_irq_ctrl_hw_t *irq_ctrl_base = get_core_num() ? &iobank0_hw->proc1_irq_ctrl : &iobank0_hw->proc0_irq_ctrl;
+    for (auto entry : _usingIRQs) {
+        int gpio = entry.first;
+
+        // There is no gpio_get_irq, so manually twiddle the register
+        io_rw_32 *en_reg = &irq_ctrl_base->inte[gpio / 8];
+        uint32_t val = ((*en_reg) >> (4 * (gpio % 8))) & 0xf;
+        _usingIRQs.insert_or_assign(gpio, val);
+        DEBUGSPI("SPIPIO: GPIO %d = %lu\n", gpio, val);
+        (*en_reg) ^= val << (4 * (gpio % 8));
+    }
+    interrupts();
+}
+
+void SPIPIO::endTransaction(void) {
+    noInterrupts(); // Avoid race condition so the GPIO IRQs won't come back until all state is restored
+    DEBUGSPI("SPIPIO::endTransaction()\n");
+    if (_hwCS) {
+        digitalWrite(_CS, HIGH);
+    }
+    // Re-enable IRQs
+    for (auto entry : _usingIRQs) {
+        int gpio = entry.first;
+        int mode = entry.second;
+        gpio_set_irq_enabled(gpio, mode, true);
+    }
+    interrupts();
+}
+
+bool SPIPIO::setRX(pin_size_t pin) {
+    if (!_running || (_RX == pin)) {
+        _RX = pin;
+        return true;
+    }
+    panic("FATAL: Attempting to set SPIPIO.RX while running");
+    return false;
+}
+
+bool SPIPIO::setCS(pin_size_t pin) {
+    if (!_running || (_CS == pin)) {
+        _CS = pin;
+        return true;
+    }
+    panic("FATAL: Attempting to set SPIPIO.CS while running");
+    return false;
+}
+
+bool SPIPIO::setSCK(pin_size_t pin) {
+    if (!_running || (_SCK == pin)) {
+        _SCK = pin;
+        return true;
+    }
+    panic("FATAL: Attempting to set SPIPIO.SCK while running");
+    return false;
+}
+
+bool SPIPIO::setTX(pin_size_t pin) {
+    if (!_running || (_TX == pin)) {
+        _TX = pin;
+        return true;
+    }
+    panic("FATAL: Attempting to set SPIPIO.TX while running");
+    return false;
+}
+
+void SPIPIO::begin(bool hwCS) {
+    DEBUGSPI("SPIPIO::begin(%d), rx=%d, cs=%d, sck=%d, tx=%d\n", hwCS, _RX, _CS, _SCK, _TX);
+    _hwCS = hwCS && (_CS != NOPIN);
+    if (_hwCS) {
+        pinMode(_CS, OUTPUT);
+        digitalWrite(_CS, HIGH);
+    }
+    // DMA is optional, if we can't get the channels we'll just use the CPU
+    _txDMA = dma_claim_unused_channel(false);
+    _rxDMA = dma_claim_unused_channel(false);
+    if ((_txDMA < 0) || (_rxDMA < 0)) {
+        DEBUGSPI("SPIPIO: Unable to claim DMA channels, using CPU transfers\n");
+        if (_txDMA >= 0) {
+            dma_channel_unclaim(_txDMA);
+        }
+        if (_rxDMA >= 0) {
+            dma_channel_unclaim(_rxDMA);
+        }
+        _txDMA = -1;
+        _rxDMA = -1;
+    }
+    _running = true;
+    // Give a default config in case user doesn't use beginTransaction
+    beginTransaction(_spis);
+    endTransaction();
+}
+
+void SPIPIO::end() {
+    DEBUGSPI("SPIPIO::end()\n");
+    _initted = false;
+    releasePIO();
+    if (_txDMA >= 0) {
+        dma_channel_unclaim(_txDMA);
+        dma_channel_unclaim(_rxDMA);
+        _txDMA = -1;
+        _rxDMA = -1;
+    }
+    gpio_set_outover(_SCK, GPIO_OVERRIDE_NORMAL);
+    if (_RX != NOPIN) {
+        gpio_set_function(_RX, GPIO_FUNC_SIO);
+    }
+    if (_hwCS) {
+        gpio_set_function(_CS, GPIO_FUNC_SIO);
+    }
+    gpio_set_function(_SCK, GPIO_FUNC_SIO);
+    gpio_set_function(_TX, GPIO_FUNC_SIO);
+    _spis = SPISettings(0, LSBFIRST, SPI_MODE0);
+    _running = false;
+}
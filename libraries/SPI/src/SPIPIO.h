@@ -0,0 +1,101 @@
+/*
+    PIO-based SPI Master library for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <api/HardwareSPI.h>
+#include <hardware/pio.h>
+#include <map>
+
+class SPIPIO : public arduino::HardwareSPI {
+public:
+    static const pin_size_t NOPIN = 0xff; // Use in constructor to disable MISO or CS
+    SPIPIO(pin_size_t rx, pin_size_t cs, pin_size_t sck, pin_size_t tx);
+    ~SPIPIO();
+
+    // Send or receive 8- or 16-bit data.  Returns read back value
+    byte transfer(uint8_t data) override;
+    uint16_t transfer16(uint16_t data) override;
+
+    // Sends buffer in 8 bit chunks.  Overwrites buffer with read data
+    void transfer(void *buf, size_t count) override;
+
+    // Sends one buffer and receives into another, much faster! can set rx or txbuf to nullptr
+    void transfer(const void *txbuf, void *rxbuf, size_t count) override;
+
+    // Call before/after every complete transaction
+    void beginTransaction(SPISettings settings) override;
+    void endTransaction(void) override;
+
+    // Assign pins, call before begin().  Any GPIO may be used
+    bool setRX(pin_size_t pin);
+    bool setCS(pin_size_t pin);
+    bool setSCK(pin_size_t pin);
+    bool setTX(pin_size_t pin);
+
+    // Transfers of this many bytes or more will use DMA, if channels are available
+    void setDMAThreshold(size_t bytes) {
+        _dmaThreshold = bytes;
+    }
+
+    // Call once to init/deinit SPI class, select pins, etc.
+    virtual void begin() override {
+        begin(false);
+    }
+    void begin(bool hwCS);
+    void end() override;
+
+    // List of GPIO IRQs to disable during a transaction
+    virtual void usingInterrupt(int interruptNumber) override {
+        _usingIRQs.insert({interruptNumber, 0});
+    }
+    virtual void notUsingInterrupt(int interruptNumber) override {
+        _usingIRQs.erase(interruptNumber);
+    }
+    virtual void attachInterrupt() override { /* noop */ }
+    virtual void detachInterrupt() override { /* noop */ }
+
+private:
+    bool cpol();
+    bool cpha();
+    bool setupPIO();
+    void releasePIO();
+    void transferDMA(const uint8_t *txbuf, uint8_t *rxbuf, size_t count);
+
+    SPISettings _spis;
+    pin_size_t _RX, _TX, _SCK, _CS;
+    bool _hwCS;
+    bool _running; // SPI port active
+    bool _initted; // Transaction begun
+
+    PIOProgram *_pgm;
+    PIO _pio;
+    int _sm;
+    int _off;
+    bool _cpha;
+    bool _lsb;
+
+    int _txDMA;
+    int _rxDMA;
+    size_t _dmaThreshold;
+
+    std::map<int, int> _usingIRQs;
+};
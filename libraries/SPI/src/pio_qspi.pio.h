@@ -0,0 +1,71 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// -------- //
+// pio_qspi //
+// -------- //
+
+#define pio_qspi_wrap_target 2
+#define pio_qspi_wrap 8
+
+static const uint16_t pio_qspi_program_instructions[] = {
+    0x4804, //  0: in     pins, 4         side 1
+    0x0080, //  1: jmp    y--, 0          side 0
+    //     .wrap_target
+    0x7028, //  2: out    x, 8            side 2
+    0x7048, //  3: out    y, 8            side 2
+    0xf08f, //  4: set    pindirs, 15     side 2
+    0x6004, //  5: out    pins, 4         side 0
+    0x0845, //  6: jmp    x--, 5          side 1
+    0xe080, //  7: set    pindirs, 0      side 0
+    0x0080, //  8: jmp    y--, 0          side 0
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program pio_qspi_program = {
+    .instructions = pio_qspi_program_instructions,
+    .length = 9,
+    .origin = -1,
+};
+
+static inline pio_sm_config pio_qspi_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + pio_qspi_wrap_target, offset + pio_qspi_wrap);
+    sm_config_set_sideset(&c, 2, false, false);
+    return c;
+}
+
+static inline void pio_qspi_program_init(PIO pio, uint sm, uint offset, float clkdiv, uint pin_sio0, uint pin_sck) {
+    pio_sm_config c = pio_qspi_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_sio0, 4);
+    sm_config_set_set_pins(&c, pin_sio0, 4);
+    sm_config_set_in_pins(&c, pin_sio0);
+    sm_config_set_sideset_pins(&c, pin_sck);
+    sm_config_set_out_shift(&c, false, true, 8);
+    sm_config_set_in_shift(&c, false, true, 8);
+    sm_config_set_clkdiv(&c, clkdiv);
+
+    // CS high, SCK low, SIO all driven low until the first transaction
+    pio_sm_set_pins_with_mask(pio, sm, 2u << pin_sck, (3u << pin_sck) | (15u << pin_sio0));
+    pio_sm_set_pindirs_with_mask(pio, sm, (3u << pin_sck) | (15u << pin_sio0), (3u << pin_sck) | (15u << pin_sio0));
+    for (uint i = 0; i < 4; i++) {
+        pio_gpio_init(pio, pin_sio0 + i);
+        // Synchronous bus, so bypass the input synchronizer to reduce input delay
+        hw_set_bits(&pio->input_sync_bypass, 1u << (pin_sio0 + i));
+    }
+    pio_gpio_init(pio, pin_sck);
+    pio_gpio_init(pio, pin_sck + 1);
+
+    // Start at the wrap target, not at the read loop
+    pio_sm_init(pio, sm, offset + pio_qspi_wrap_target, &c);
+}
+
+#endif
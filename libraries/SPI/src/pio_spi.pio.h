@@ -0,0 +1,91 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------------- //
+// pio_spi_cpha0 //
+// ------------- //
+
+#define pio_spi_cpha0_wrap_target 0
+#define pio_spi_cpha0_wrap 1
+
+static const uint16_t pio_spi_cpha0_program_instructions[] = {
+    //     .wrap_target
+    0x6001, //  0: out    pins, 1         side 0
+    0x5001, //  1: in     pins, 1         side 1
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program pio_spi_cpha0_program = {
+    .instructions = pio_spi_cpha0_program_instructions,
+    .length = 2,
+    .origin = -1,
+};
+
+static inline pio_sm_config pio_spi_cpha0_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + pio_spi_cpha0_wrap_target, offset + pio_spi_cpha0_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+#endif
+
+// ------------- //
+// pio_spi_cpha1 //
+// ------------- //
+
+#define pio_spi_cpha1_wrap_target 0
+#define pio_spi_cpha1_wrap 2
+
+static const uint16_t pio_spi_cpha1_program_instructions[] = {
+    //     .wrap_target
+    0x6021, //  0: out    x, 1            side 0
+    0xb101, //  1: mov    pins, x         side 1 [1]
+    0x4001, //  2: in     pins, 1         side 0
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program pio_spi_cpha1_program = {
+    .instructions = pio_spi_cpha1_program_instructions,
+    .length = 3,
+    .origin = -1,
+};
+
+static inline pio_sm_config pio_spi_cpha1_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + pio_spi_cpha1_wrap_target, offset + pio_spi_cpha1_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+
+static inline void pio_spi_program_init(PIO pio, uint sm, uint offset, bool cpha, float clkdiv, bool lsbFirst, uint pin_sck, uint pin_mosi, uint pin_miso) {
+    pio_sm_config c = cpha ? pio_spi_cpha1_program_get_default_config(offset) : pio_spi_cpha0_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_mosi, 1);
+    sm_config_set_in_pins(&c, pin_miso);
+    sm_config_set_sideset_pins(&c, pin_sck);
+    sm_config_set_out_shift(&c, lsbFirst, true, 8);
+    sm_config_set_in_shift(&c, lsbFirst, true, 8);
+    sm_config_set_clkdiv(&c, clkdiv);
+
+    // MOSI, SCK output are low, MISO is input
+    pio_sm_set_pins_with_mask(pio, sm, 0, (1u << pin_sck) | (1u << pin_mosi));
+    pio_sm_set_pindirs_with_mask(pio, sm, (1u << pin_sck) | (1u << pin_mosi), (1u << pin_sck) | (1u << pin_mosi) | (1u << pin_miso));
+    pio_gpio_init(pio, pin_mosi);
+    pio_gpio_init(pio, pin_miso);
+    pio_gpio_init(pio, pin_sck);
+
+    // SPI is synchronous, so bypass input synchroniser to reduce input delay
+    hw_set_bits(&pio->input_sync_bypass, 1u << pin_miso);
+
+    pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif
@@ -0,0 +1,44 @@
+// Walks 18 servos (6 legs x 3 joints) through a simple gait using a single
+// PIO state machine.  Each step stages new targets for every joint and then
+// commits them together, so all legs start moving on the same frame.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <ServoBank.h>
+
+ServoBank legs;
+
+// GPIO 2..19 drive the servos, 3 per leg (hip, knee, foot)
+const int firstPin = 2;
+const int numServos = 18;
+
+void setup() {
+  Serial.begin(115200);
+  for (int i = 0; i < numServos; i++) {
+    legs.attach(firstPin + i, 600, 2400, 1500);
+  }
+  if (!legs.begin(50)) {
+    Serial.println("Unable to start ServoBank");
+  }
+}
+
+void step(int phase) {
+  for (int leg = 0; leg < 6; leg++) {
+    // Alternate tripods, legs 0/2/4 and 1/3/5, are always out of phase
+    bool lift = ((leg & 1) == (phase & 1));
+    legs.moveTo(leg * 3 + 0, lift ? 1800 : 1200, 400); // Hip swings
+    legs.moveTo(leg * 3 + 1, lift ? 1900 : 1500, 200); // Knee lifts quickly
+    legs.moveTo(leg * 3 + 2, lift ? 1300 : 1500, 200); // Foot tucks
+  }
+  legs.commit();
+}
+
+void loop() {
+  static int phase = 0;
+  step(phase++);
+  while (legs.moving()) {
+    delay(1);
+  }
+  Serial.printf("Step %d, hip 0 at %.1fus\n", phase, legs.readMicroseconds(0));
+  delay(100);
+}
@@ -0,0 +1,371 @@
+/*
+    Multi-channel servo engine for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ServoBank.h"
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include "servo_bank.pio.h"
+
+static PIOProgram _servoBankPgm(&servo_bank_program);
+
+static int _bankCount = 0;                   // Remove our IRQ handler when this hits 0
+static ServoBank *_bankMap[NUM_DMA_CHANNELS]; // Indexed by control DMA channel
+
+// Each segment is 3 cycles of overhead in the PIO program
+static constexpr uint32_t MIN_SEGMENT = 3;
+
+extern int improved_map(int value, int minIn, int maxIn, int minOut, int maxOut);
+
+ServoBank::ServoBank() {
+    _running = false;
+    _count = 0;
+    _pinBase = 0;
+    _frameCycles = 0;
+    _frameHz = 50;
+    _commitPending = false;
+    _moving = false;
+    _pio = nullptr;
+    _sm = -1;
+    _dma = -1;
+    _ctrlDMA = -1;
+    _table[0] = nullptr;
+    _table[1] = nullptr;
+    _active = nullptr;
+    _tableWords = 0;
+}
+
+ServoBank::~ServoBank() {
+    end();
+}
+
+int32_t ServoBank::usToCycles(float us) {
+    return (int32_t)(us * (clock_get_hz(clk_sys) / 1000000.0f) + 0.5f);
+}
+
+int ServoBank::attach(pin_size_t pin, int minUs, int maxUs, int valueUs) {
+    if (_running || (_count == MAX_CHANNELS) || (pin > 29)) {
+        DEBUGCORE("ERROR: ServoBank unable to attach pin %d\n", pin);
+        return -1;
+    }
+    for (int i = 0; i < _count; i++) {
+        if (_ch[i].pin == pin) {
+            return -1;
+        }
+    }
+    Channel *c = &_ch[_count];
+    c->pin = pin;
+    // Same limits as the Servo class
+    c->maxUs = max(250, min(3000, maxUs));
+    c->minUs = max(200, min(c->maxUs, minUs));
+    c->min = usToCycles(c->minUs);
+    c->max = usToCycles(c->maxUs);
+    c->staged = constrain(usToCycles(valueUs), c->min, c->max);
+    c->stagedFrames = 0;
+    c->pending = c->staged;
+    c->pendingFrames = 0;
+    c->target = c->staged;
+    c->pos = (int64_t)c->staged << 16;
+    c->step = 0;
+    c->framesLeft = 0;
+    return _count++;
+}
+
+bool ServoBank::begin(int frameHz) {
+    if (_running) {
+        return true;
+    }
+    if (!_count) {
+        DEBUGCORE("ERROR: ServoBank has no servos attached\n");
+        return false;
+    }
+    _frameHz = constrain(frameHz, 40, 400);
+    _frameCycles = clock_get_hz(clk_sys) / _frameHz;
+
+    // Keep every pulse inside the frame, leaving room for the padding segments
+    int32_t limit = _frameCycles * 9 / 10;
+    uint32_t pinMask = 0;
+    int lo = 29, hi = 0;
+    for (int i = 0; i < _count; i++) {
+        _ch[i].max = min(_ch[i].max, limit);
+        _ch[i].min = min(_ch[i].min, _ch[i].max);
+        _ch[i].staged = constrain(_ch[i].staged, _ch[i].min, _ch[i].max);
+        _ch[i].pending = _ch[i].staged;
+        _ch[i].target = _ch[i].staged;
+        _ch[i].pos = (int64_t)_ch[i].staged << 16;
+        pinMask |= 1u << _ch[i].pin;
+        lo = min(lo, (int)_ch[i].pin);
+        hi = max(hi, (int)_ch[i].pin);
+    }
+    _pinBase = lo;
+
+    int off;
+    if (!_servoBankPgm.prepare(&_pio, &_sm, &off)) {
+        DEBUGCORE("ERROR: ServoBank unable to allocate PIO, out of resources\n");
+        return false;
+    }
+    _dma = dma_claim_unused_channel(false);
+    _ctrlDMA = dma_claim_unused_channel(false);
+    if ((_dma < 0) || (_ctrlDMA < 0)) {
+        DEBUGCORE("ERROR: ServoBank unable to claim DMA\n");
+        if (_dma >= 0) {
+            dma_channel_unclaim(_dma);
+        }
+        if (_ctrlDMA >= 0) {
+            dma_channel_unclaim(_ctrlDMA);
+        }
+        _dma = -1;
+        _ctrlDMA = -1;
+        pio_sm_unclaim(_pio, _sm);
+        return false;
+    }
+
+    // Always 1 segment per servo plus the frame tail, so the DMA length never changes
+    _tableWords = 2 * (_count + 1);
+    _table[0] = new uint32_t[_tableWords];
+    _table[1] = new uint32_t[_tableWords];
+    buildTable(_table[0]);
+    _active = _table[0];
+    _commitPending = false;
+    _moving = false;
+
+    servo_bank_program_init(_pio, _sm, off, lo, hi - lo + 1, pinMask);
+
+    dma_channel_config c = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, true));
+    channel_config_set_chain_to(&c, _ctrlDMA);
+    dma_channel_configure(_dma, &c, &_pio->txf[_sm], _active, _tableWords, false);
+
+    // Restarts the table DMA at the current active table, and IRQs so the next frame can be prepared
+    c = dma_channel_get_default_config(_ctrlDMA);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_irq_quiet(&c, false);
+    dma_channel_configure(_ctrlDMA, &c, &dma_hw->ch[_dma].al3_read_addr_trig, &_active, 1, false);
+
+    noInterrupts();
+    _bankMap[_ctrlDMA] = this;
+    dma_channel_set_irq1_enabled(_ctrlDMA, true);
+    if (!_bankCount++) {
+        irq_add_shared_handler(DMA_IRQ_1, _irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+    }
+    interrupts();
+
+    pio_sm_set_enabled(_pio, _sm, true);
+    dma_channel_start(_ctrlDMA);
+    _running = true;
+    return true;
+}
+
+void ServoBank::end() {
+    if (!_running) {
+        return;
+    }
+    _running = false;
+    noInterrupts();
+    dma_channel_set_irq1_enabled(_ctrlDMA, false);
+    _bankMap[_ctrlDMA] = nullptr;
+    if (!--_bankCount) {
+        irq_remove_handler(DMA_IRQ_1, _irq);
+    }
+    interrupts();
+
+    // Break the chain so nothing can be restarted, then stop everything
+    dma_channel_config c = dma_get_channel_config(_dma);
+    channel_config_set_chain_to(&c, _dma);
+    dma_channel_set_config(_dma, &c, false);
+    dma_channel_abort(_ctrlDMA);
+    dma_channel_abort(_dma);
+    dma_channel_acknowledge_irq1(_ctrlDMA);
+    dma_channel_unclaim(_ctrlDMA);
+    dma_channel_unclaim(_dma);
+    _dma = -1;
+    _ctrlDMA = -1;
+
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_sm_unclaim(_pio, _sm);
+    for (int i = 0; i < _count; i++) {
+        pinMode(_ch[i].pin, OUTPUT);
+        digitalWrite(_ch[i].pin, LOW);
+    }
+    delete[] _table[0];
+    delete[] _table[1];
+    _table[0] = nullptr;
+    _table[1] = nullptr;
+    _active = nullptr;
+}
+
+void ServoBank::write(int channel, int value) {
+    if ((channel < 0) || (channel >= _count)) {
+        return;
+    }
+    // treat any value less than 200 as angle in degrees (values equal or larger are handled as microseconds)
+    if (value < 200) {
+        value = constrain(value, 0, 180);
+        value = improved_map(value, 0, 180, _ch[channel].minUs, _ch[channel].maxUs);
+    }
+    writeMicroseconds(channel, value);
+}
+
+void ServoBank::writeMicroseconds(int channel, float us) {
+    moveTo(channel, us, 0);
+}
+
+void ServoBank::moveTo(int channel, float us, uint32_t ms) {
+    if ((channel < 0) || (channel >= _count)) {
+        return;
+    }
+    Channel *c = &_ch[channel];
+    c->staged = constrain(usToCycles(us), c->min, c->max);
+    c->stagedFrames = (uint64_t)ms * _frameHz / 1000;
+}
+
+void ServoBank::commit() {
+    if (!_running) {
+        // Nothing playing yet, so just take the new positions directly
+        for (int i = 0; i < _count; i++) {
+            _ch[i].target = _ch[i].staged;
+            _ch[i].pos = (int64_t)_ch[i].staged << 16;
+            _ch[i].framesLeft = 0;
+        }
+        return;
+    }
+    // Only 1 commit can be in flight, the frame IRQ will take it within 1 frame
+    while (_commitPending) {
+        /* noop */
+    }
+    for (int i = 0; i < _count; i++) {
+        _ch[i].pending = _ch[i].staged;
+        _ch[i].pendingFrames = _ch[i].stagedFrames;
+    }
+    __dmb();
+    _commitPending = true;
+}
+
+float ServoBank::readMicroseconds(int channel) {
+    if ((channel < 0) || (channel >= _count)) {
+        return 0.0f;
+    }
+    return (float)(_ch[channel].pos >> 16) * 1000000.0f / clock_get_hz(clk_sys);
+}
+
+bool ServoBank::moving() {
+    return _moving || _commitPending;
+}
+
+// Segments are (pin states, length - 3).  All servos start high together, then each
+// segment drops the ones which have finished.  Unused segments pad out the frame tail.
+void ServoBank::buildTable(uint32_t *table) {
+    uint8_t order[MAX_CHANNELS];
+    uint32_t width[MAX_CHANNELS];
+    uint32_t mask = 0;
+    for (int i = 0; i < _count; i++) {
+        width[i] = _ch[i].pos >> 16;
+        mask |= 1u << (_ch[i].pin - _pinBase);
+        // Insertion sort by pulse width, there are never many servos
+        int j = i;
+        while ((j > 0) && (width[order[j - 1]] > width[i])) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    int seg = 0;
+    uint32_t t = 0;
+    int i = 0;
+    while (i < _count) {
+        // Anything ending too soon after the last edge to fit a segment ends with it
+        uint32_t end = max(width[order[i]], t + MIN_SEGMENT);
+        table[seg * 2] = mask;
+        table[seg * 2 + 1] = end - t - MIN_SEGMENT;
+        seg++;
+        while ((i < _count) && (width[order[i]] < end + MIN_SEGMENT)) {
+            mask &= ~(1u << (_ch[order[i]].pin - _pinBase));
+            i++;
+        }
+        t = end;
+    }
+    // Everything is low now.  Pad the remaining segments, then the rest of the frame
+    while (seg < _count) {
+        table[seg * 2] = 0;
+        table[seg * 2 + 1] = 0;
+        seg++;
+        t += MIN_SEGMENT;
+    }
+    table[seg * 2] = 0;
+    table[seg * 2 + 1] = _frameCycles - t - MIN_SEGMENT;
+}
+
+// Called once per frame, right after the DMA has picked up the next table
+void ServoBank::frame() {
+    bool changed = false;
+    if (_commitPending) {
+        for (int i = 0; i < _count; i++) {
+            Channel *c = &_ch[i];
+            // commit() may overwrite pending as soon as this is taken, so keep our own copy
+            c->target = c->pending;
+            if (!c->pendingFrames) {
+                c->pos = (int64_t)c->target << 16;
+                c->framesLeft = 0;
+            } else {
+                c->step = (((int64_t)c->target << 16) - c->pos) / (int64_t)c->pendingFrames;
+                c->framesLeft = c->pendingFrames;
+            }
+        }
+        __dmb();
+        _commitPending = false;
+        changed = true;
+    }
+    bool moving = false;
+    for (int i = 0; i < _count; i++) {
+        Channel *c = &_ch[i];
+        if (c->framesLeft) {
+            if (--c->framesLeft) {
+                c->pos += c->step;
+                moving = true;
+            } else {
+                c->pos = (int64_t)c->target << 16; // Land exactly on the target
+            }
+            changed = true;
+        }
+    }
+    _moving = moving;
+    if (changed) {
+        uint32_t *next = (_active == _table[0]) ? _table[1] : _table[0];
+        buildTable(next);
+        __dmb();
+        _active = next;
+    }
+}
+
+void __not_in_flash_func(ServoBank::_irq)() {
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (_bankMap[i] && dma_channel_get_irq1_status(i)) {
+            dma_channel_acknowledge_irq1(i);
+            _bankMap[i]->frame();
+        }
+    }
+}
@@ -0,0 +1,110 @@
+/*
+    Multi-channel servo engine for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+    A ServoBank drives up to 30 servos from a single PIO state machine and
+    2 DMA channels.  Every frame the DMA replays a table of pin states and
+    delays, so all pulses start together and CPU time is only used to
+    rebuild the table when positions change.
+
+    Positions written with write()/writeMicroseconds()/moveTo() are staged,
+    and only take effect together at the start of the frame after commit().
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/pio.h>
+#include <Servo.h> // For the DEFAULT_xxx_PULSE_WIDTH values
+
+class ServoBank {
+public:
+    static constexpr int MAX_CHANNELS = 30;
+
+    ServoBank();
+    ~ServoBank();
+
+    // All servos must be attached before begin().  Returns the channel number, or -1 on error
+    int attach(pin_size_t pin, int minUs = DEFAULT_MIN_PULSE_WIDTH, int maxUs = DEFAULT_MAX_PULSE_WIDTH, int valueUs = DEFAULT_NEUTRAL_PULSE_WIDTH);
+
+    // Frame rate from 40 to 400Hz.  Pulse widths are limited to 90% of the frame
+    bool begin(int frameHz = 50);
+    void end();
+
+    // Staged until commit().  Values < 200 are angles, like Servo::write()
+    void write(int channel, int value);
+    void writeMicroseconds(int channel, float us);
+
+    // Staged until commit().  Moves linearly from the current position, updated every frame
+    void moveTo(int channel, float us, uint32_t ms);
+
+    // Starts all staged positions and moves together at the beginning of the next frame
+    void commit();
+
+    // Actual pulse width being sent right now
+    float readMicroseconds(int channel);
+
+    // True while any moveTo() is still in progress
+    bool moving();
+
+    int channels() {
+        return _count;
+    }
+
+private:
+    typedef struct {
+        pin_size_t pin;
+        int minUs;
+        int maxUs;
+        int32_t min;           // Limits, in cycles
+        int32_t max;
+        int32_t staged;        // Target from write()/moveTo(), in cycles
+        uint32_t stagedFrames; // Frames to reach target, 0 for immediately
+        int32_t pending;       // Copied from staged by commit(), consumed by the frame IRQ
+        uint32_t pendingFrames;
+        int32_t target;        // Where the move in progress ends, owned by the frame IRQ
+        int64_t pos;           // Current position, in cycles << 16
+        int64_t step;          // Per-frame change, in cycles << 16
+        uint32_t framesLeft;
+    } Channel;
+
+    void buildTable(uint32_t *table);
+    void frame();
+    int32_t usToCycles(float us);
+    static void _irq();
+
+    bool _running;
+    int _count;
+    Channel _ch[MAX_CHANNELS];
+    uint32_t _pinBase;
+    uint32_t _frameCycles;
+    uint32_t _frameHz;
+
+    volatile bool _commitPending;
+    volatile bool _moving;
+
+    PIO _pio;
+    int _sm;
+    int _dma;
+    int _ctrlDMA;
+    uint32_t *_table[2];
+    uint32_t *volatile _active; // Read by the control DMA at the start of every frame
+    int _tableWords;
+};
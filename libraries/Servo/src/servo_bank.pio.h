@@ -0,0 +1,54 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ---------- //
+// servo_bank //
+// ---------- //
+
+#define servo_bank_wrap_target 0
+#define servo_bank_wrap 2
+
+static const uint16_t servo_bank_program_instructions[] = {
+    //     .wrap_target
+    0x6000, //  0: out    pins, 32
+    0x6020, //  1: out    x, 32
+    0x0042, //  2: jmp    x--, 2
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program servo_bank_program = {
+    .instructions = servo_bank_program_instructions,
+    .length = 3,
+    .origin = -1,
+};
+
+static inline pio_sm_config servo_bank_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + servo_bank_wrap_target, offset + servo_bank_wrap);
+    return c;
+}
+
+static inline void servo_bank_program_init(PIO pio, uint sm, uint offset, uint pin_base, uint pin_count, uint32_t pin_mask) {
+    pio_sm_config c = servo_bank_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_base, pin_count);
+    sm_config_set_out_shift(&c, true, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    pio_sm_set_pins_with_mask(pio, sm, 0, pin_mask);
+    pio_sm_set_pindirs_with_mask(pio, sm, pin_mask, pin_mask);
+    for (uint i = 0; i < 30; i++) {
+        if (pin_mask & (1u << i)) {
+            pio_gpio_init(pio, i);
+        }
+    }
+    pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif
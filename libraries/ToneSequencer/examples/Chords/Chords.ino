@@ -0,0 +1,40 @@
+// Plays a bass line and a 2-voice chord progression together on one pin
+// using PWM.  Connect GPIO 15 through a 1K resistor with a 100nF capacitor
+// to ground, and feed the capacitor side to an amplifier or headphones.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <ToneSequencer.h>
+
+PolyTone synth(15, 3);
+
+const ToneNote bass[] = {
+  { 131, 500, 50 }, { 131, 500, 50 }, { 110, 500, 50 }, { 110, 500, 50 },
+  { 175, 500, 50 }, { 175, 500, 50 }, { 196, 500, 50 }, { 196, 500, 50 },
+};
+
+const ToneNote third[] = {
+  { 330, 1000, 25 }, { 262, 1000, 25 }, { 349, 1000, 25 }, { 392, 1000, 25 },
+};
+
+const ToneNote fifth[] = {
+  { 392, 1000, 25 }, { 330, 1000, 25 }, { 440, 1000, 25 }, { 494, 1000, 25 },
+};
+
+void setup() {
+  Serial.begin(115200);
+  synth.setVolume(0, 255);
+  synth.setVolume(1, 160);
+  synth.setVolume(2, 160);
+  synth.setEnvelope(1, 20, 200);
+  synth.setEnvelope(2, 20, 200);
+  synth.play(0, bass, sizeof(bass) / sizeof(bass[0]), true);
+  synth.play(1, third, sizeof(third) / sizeof(third[0]), true);
+  synth.play(2, fifth, sizeof(fifth) / sizeof(fifth[0]), true);
+  synth.begin();
+}
+
+void loop() {
+  Serial.printf("Voices playing: %s\n", synth.playing() ? "yes" : "no");
+  delay(1000);
+}
@@ -0,0 +1,28 @@
+// Plays a looping melody on a piezo buzzer on GPIO 15 while the main loop
+// keeps blinking the LED.  Once started, the PIO and DMA play every note
+// with no further CPU work.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <ToneSequencer.h>
+
+Melody melody(15);
+
+// Frequency (Hz), duration (ms), duty (%)
+const ToneNote tune[] = {
+  { 523, 200, 50 }, { 659, 200, 50 }, { 784, 200, 50 }, { 1047, 400, 50 },
+  { 0, 100, 0 },
+  { 784, 200, 25 }, { 1047, 600, 25 },
+  { 0, 500, 0 },
+};
+
+void setup() {
+  pinMode(LED_BUILTIN, OUTPUT);
+  melody.begin();
+  melody.play(tune, sizeof(tune) / sizeof(tune[0]), true);
+}
+
+void loop() {
+  digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  delay(250);
+}
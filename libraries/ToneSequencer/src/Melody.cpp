@@ -0,0 +1,189 @@
+/*
+    DMA driven tone sequencing for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "Melody.h"
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include "tone_sequencer.pio.h"
+
+static PIOProgram _melodyPgm(&tone_sequencer_program);
+
+Melody::Melody(pin_size_t pin) {
+    _pin = pin;
+    _running = false;
+    _loop = false;
+    _pio = nullptr;
+    _sm = -1;
+    _off = 0;
+    _dma = -1;
+    _ctrlDMA = -1;
+    _buf = nullptr;
+    _bufWords = 0;
+    _bufStart = nullptr;
+}
+
+Melody::~Melody() {
+    end();
+}
+
+bool Melody::begin() {
+    if (_running) {
+        return true;
+    }
+    if (_pin > 29) {
+        DEBUGCORE("ERROR: Illegal pin in Melody (%d)\n", _pin);
+        return false;
+    }
+    if (!_melodyPgm.prepare(&_pio, &_sm, &_off)) {
+        DEBUGCORE("ERROR: Melody unable to start, out of PIO resources\n");
+        return false;
+    }
+    _dma = dma_claim_unused_channel(false);
+    _ctrlDMA = dma_claim_unused_channel(false);
+    if ((_dma < 0) || (_ctrlDMA < 0)) {
+        DEBUGCORE("ERROR: Melody unable to claim DMA\n");
+        if (_dma >= 0) {
+            dma_channel_unclaim(_dma);
+        }
+        if (_ctrlDMA >= 0) {
+            dma_channel_unclaim(_ctrlDMA);
+        }
+        _dma = -1;
+        _ctrlDMA = -1;
+        pio_sm_unclaim(_pio, _sm);
+        return false;
+    }
+    tone_sequencer_program_init(_pio, _sm, _off, _pin);
+    pio_sm_set_enabled(_pio, _sm, true);
+    _running = true;
+    return true;
+}
+
+void Melody::end() {
+    if (!_running) {
+        return;
+    }
+    stop();
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_sm_unclaim(_pio, _sm);
+    dma_channel_unclaim(_ctrlDMA);
+    dma_channel_unclaim(_dma);
+    _dma = -1;
+    _ctrlDMA = -1;
+    free(_buf);
+    _buf = nullptr;
+    _bufWords = 0;
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+    _running = false;
+}
+
+void Melody::stop() {
+    if (!_running) {
+        return;
+    }
+    // Break the chain so a looping list can't restart, then drop whatever the PIO had queued
+    dma_channel_config c = dma_get_channel_config(_dma);
+    channel_config_set_chain_to(&c, _dma);
+    dma_channel_set_config(_dma, &c, false);
+    dma_channel_abort(_ctrlDMA);
+    dma_channel_abort(_dma);
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_sm_clear_fifos(_pio, _sm);
+    pio_sm_restart(_pio, _sm);
+    pio_sm_exec(_pio, _sm, pio_encode_jmp(_off) | pio_encode_sideset_opt(1, 0));
+    pio_sm_set_enabled(_pio, _sm, true);
+    _loop = false;
+}
+
+bool Melody::play(const ToneNote *notes, size_t count, bool loop) {
+    if (!_running || !notes || !count) {
+        return false;
+    }
+    stop();
+
+    if (count * 3 > _bufWords) {
+        uint32_t *b = (uint32_t *)realloc(_buf, count * 3 * sizeof(uint32_t));
+        if (!b) {
+            DEBUGCORE("ERROR: Melody unable to allocate %u notes\n", (unsigned)count);
+            return false;
+        }
+        _buf = b;
+        _bufWords = count * 3;
+    }
+
+    // Convert to the PIO's (periods - 1, high - 2 or 0 for a rest, low - 5) triplets.  See tone_sequencer.pio
+    uint32_t sys = clock_get_hz(clk_sys);
+    uint32_t *p = _buf;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t periods, high, low;
+        if (!notes[i].frequency || !notes[i].duty) {
+            // Rests count out 1ms periods
+            periods = notes[i].ms;
+            high = 0;
+            low = sys / 1000;
+        } else {
+            uint32_t period = sys / notes[i].frequency;
+            periods = ((uint32_t)notes[i].frequency * notes[i].ms + 500) / 1000;
+            high = (uint64_t)period * min((uint8_t)100, notes[i].duty) / 100;
+            high = constrain(high, 3, period - 5);
+            low = period - high;
+        }
+        *p++ = periods ? periods - 1 : 0;
+        *p++ = high ? high - 2 : 0;
+        *p++ = low - 5;
+    }
+
+    _loop = loop;
+    _bufStart = _buf;
+    dma_channel_config c = dma_channel_get_default_config(_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, _sm, true));
+    channel_config_set_chain_to(&c, loop ? _ctrlDMA : _dma);
+    dma_channel_configure(_dma, &c, &_pio->txf[_sm], _buf, count * 3, false);
+
+    if (loop) {
+        // Rewrites the note channel's read address, which retriggers it
+        c = dma_channel_get_default_config(_ctrlDMA);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, false);
+        dma_channel_configure(_ctrlDMA, &c, &dma_hw->ch[_dma].al3_read_addr_trig, &_bufStart, 1, false);
+    }
+    dma_channel_start(_dma);
+    return true;
+}
+
+bool Melody::playing() {
+    if (!_running) {
+        return false;
+    }
+    if (_loop || dma_channel_is_busy(_dma)) {
+        return true;
+    }
+    // Nothing more is coming, so an empty FIFO with the SM sitting on its first pull means the last note is done
+    if (!pio_sm_is_tx_fifo_empty(_pio, _sm)) {
+        return true;
+    }
+    return pio_sm_get_pc(_pio, _sm) != _off;
+}
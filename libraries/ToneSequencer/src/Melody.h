@@ -0,0 +1,58 @@
+/*
+    DMA driven tone sequencing for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "ToneNote.h"
+#include <hardware/pio.h>
+
+// Plays a whole list of notes on one pin from a PIO state machine fed by DMA.
+// The PIO counts out every period and note length itself, so there is no
+// CPU work or timer interrupt per note, unlike tone(pin, freq, duration).
+class Melody {
+public:
+    Melody(pin_size_t pin);
+    ~Melody();
+
+    bool begin();
+    void end();
+
+    // Starts playing immediately, replacing anything already playing.  The list is
+    // converted to PIO timings on the call, so the notes may be freed afterwards.
+    // With loop the list repeats until stop()
+    bool play(const ToneNote *notes, size_t count, bool loop = false);
+    void stop();
+
+    // True until the last note has finished (always true while looping)
+    bool playing();
+
+private:
+    pin_size_t _pin;
+    bool _running;
+    bool _loop;
+    PIO _pio;
+    int _sm;
+    int _off;
+    int _dma;
+    int _ctrlDMA;
+    uint32_t *_buf;
+    size_t _bufWords;
+    uint32_t *_bufStart; // Read by the control DMA to restart a looping list
+};
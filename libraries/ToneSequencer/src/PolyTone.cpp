@@ -0,0 +1,282 @@
+/*
+    DMA driven tone sequencing for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "PolyTone.h"
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/pwm.h>
+
+static int _polyCount = 0;                   // Remove our IRQ handler when this hits 0
+static PolyTone *_polyMap[NUM_DMA_CHANNELS]; // Indexed by either DMA channel of the pair
+
+PolyTone::PolyTone(pin_size_t pin, int voices) {
+    _pin = pin;
+    _voices = constrain(voices, 1, MAX_VOICES);
+    _running = false;
+    _rate = 0;
+    _top = 0;
+    _dma[0] = -1;
+    _dma[1] = -1;
+    memset(_v, 0, sizeof(_v));
+    for (int i = 0; i < MAX_VOICES; i++) {
+        _v[i].volume = 255;
+        _v[i].attackMs = 5;
+        _v[i].releaseMs = 5;
+    }
+}
+
+PolyTone::~PolyTone() {
+    end();
+}
+
+bool PolyTone::begin(int sampleRate) {
+    if (_running) {
+        return true;
+    }
+    if (_pin > 29) {
+        DEBUGCORE("ERROR: Illegal pin in PolyTone (%d)\n", _pin);
+        return false;
+    }
+    uint32_t sys = clock_get_hz(clk_sys);
+    // The PWM wrap paces the DMA, so its period is the sample period and top is the resolution
+    _rate = constrain((uint32_t)sampleRate, sys / 65536 + 1, sys / 256);
+    _top = sys / _rate;
+
+    _dma[0] = dma_claim_unused_channel(false);
+    _dma[1] = dma_claim_unused_channel(false);
+    if ((_dma[0] < 0) || (_dma[1] < 0)) {
+        DEBUGCORE("ERROR: PolyTone unable to claim DMA\n");
+        for (int i = 0; i < 2; i++) {
+            if (_dma[i] >= 0) {
+                dma_channel_unclaim(_dma[i]);
+            }
+            _dma[i] = -1;
+        }
+        return false;
+    }
+
+    for (int i = 0; i < MAX_VOICES; i++) {
+        _v[i].notes = nullptr;
+        setEnvelope(i, _v[i].attackMs, _v[i].releaseMs);
+    }
+    fill(_buf[0]);
+    fill(_buf[1]);
+
+    uint slice = pwm_gpio_to_slice_num(_pin);
+    pwm_config pc = pwm_get_default_config();
+    pwm_config_set_wrap(&pc, _top - 1);
+    pwm_init(slice, &pc, true);
+    pwm_set_gpio_level(_pin, 0);
+    gpio_set_function(_pin, GPIO_FUNC_PWM);
+
+    // Ping-pong between the 2 buffers, each refilled by the IRQ while the other plays.  16-bit
+    // writes are replicated across CC, so the other pin of the slice (if it's set to PWM) will follow
+    for (int i = 0; i < 2; i++) {
+        dma_channel_config c = dma_channel_get_default_config(_dma[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pwm_get_dreq(slice));
+        channel_config_set_chain_to(&c, _dma[i ^ 1]);
+        channel_config_set_irq_quiet(&c, false);
+        dma_channel_configure(_dma[i], &c, &pwm_hw->slice[slice].cc, _buf[i], BLOCK, false);
+    }
+
+    noInterrupts();
+    for (int i = 0; i < 2; i++) {
+        _polyMap[_dma[i]] = this;
+        dma_channel_set_irq1_enabled(_dma[i], true);
+    }
+    if (!_polyCount++) {
+        irq_add_shared_handler(DMA_IRQ_1, _irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+    }
+    interrupts();
+
+    dma_channel_start(_dma[0]);
+    _running = true;
+    return true;
+}
+
+void PolyTone::end() {
+    if (!_running) {
+        return;
+    }
+    _running = false;
+    noInterrupts();
+    for (int i = 0; i < 2; i++) {
+        dma_channel_set_irq1_enabled(_dma[i], false);
+        _polyMap[_dma[i]] = nullptr;
+    }
+    if (!--_polyCount) {
+        irq_remove_handler(DMA_IRQ_1, _irq);
+    }
+    interrupts();
+
+    // Break the ping-pong chain before aborting so neither can restart the other
+    for (int i = 0; i < 2; i++) {
+        dma_channel_config c = dma_get_channel_config(_dma[i]);
+        channel_config_set_chain_to(&c, _dma[i]);
+        dma_channel_set_config(_dma[i], &c, false);
+    }
+    for (int i = 0; i < 2; i++) {
+        dma_channel_abort(_dma[i]);
+        dma_channel_acknowledge_irq1(_dma[i]);
+        dma_channel_unclaim(_dma[i]);
+        _dma[i] = -1;
+    }
+    pwm_set_enabled(pwm_gpio_to_slice_num(_pin), false);
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+}
+
+bool PolyTone::play(int voice, const ToneNote *notes, size_t count, bool loop) {
+    if ((voice < 0) || (voice >= _voices)) {
+        return false;
+    }
+    Voice *v = &_v[voice];
+    // Only 1 change can be handed over at a time, the IRQ takes it within 1 block
+    while (_running && v->nextPending) {
+        /* noop */
+    }
+    v->nextNotes = count ? notes : nullptr;
+    v->nextCount = count;
+    v->nextLoop = loop;
+    __dmb();
+    v->nextPending = true; // Before begin() this just waits for the first fill()
+    return true;
+}
+
+void PolyTone::stop(int voice) {
+    play(voice, nullptr, 0);
+}
+
+bool PolyTone::playing(int voice) {
+    if ((voice < 0) || (voice >= _voices)) {
+        return false;
+    }
+    return _v[voice].nextPending ? _v[voice].nextNotes != nullptr : _v[voice].notes != nullptr;
+}
+
+bool PolyTone::playing() {
+    for (int i = 0; i < _voices; i++) {
+        if (playing(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PolyTone::setVolume(int voice, uint8_t volume) {
+    if ((voice >= 0) && (voice < _voices)) {
+        _v[voice].volume = volume;
+    }
+}
+
+void PolyTone::setEnvelope(int voice, uint16_t attackMs, uint16_t releaseMs) {
+    if ((voice < 0) || (voice >= _voices)) {
+        return;
+    }
+    _v[voice].attackMs = attackMs;
+    _v[voice].releaseMs = releaseMs;
+    // Takes effect on the next note.  Limited so the gain math in fill() can't overflow
+    _v[voice].attack = min(65535ul, (uint32_t)attackMs * _rate / 1000);
+    _v[voice].release = min(65535ul, (uint32_t)releaseMs * _rate / 1000);
+}
+
+// Sets up the note at v->idx, or silences the voice if there's nothing left
+void PolyTone::startNote(Voice *v) {
+    if (v->notes && (v->idx >= v->count)) {
+        if (v->loop) {
+            v->idx = 0;
+        } else {
+            v->notes = nullptr;
+        }
+    }
+    v->elapsed = 0;
+    v->phase = 0;
+    if (!v->notes) {
+        v->length = 0;
+        v->inc = 0;
+        v->duty = 0;
+        return;
+    }
+    const ToneNote *n = &v->notes[v->idx];
+    v->length = max(1ul, (uint32_t)n->ms * _rate / 1000);
+    v->inc = ((uint64_t)n->frequency << 32) / _rate;
+    v->duty = (n->frequency && n->duty) ? (uint32_t)(((uint64_t)min((uint8_t)100, n->duty) << 32) / 100 - 1) : 0;
+}
+
+void PolyTone::fill(uint16_t *buf) {
+    for (int i = 0; i < _voices; i++) {
+        Voice *v = &_v[i];
+        if (v->nextPending) {
+            v->notes = v->nextNotes;
+            v->count = v->nextCount;
+            v->loop = v->nextLoop;
+            v->idx = 0;
+            startNote(v);
+            __dmb();
+            v->nextPending = false;
+        }
+    }
+    for (int s = 0; s < BLOCK; s++) {
+        uint32_t sum = 0;
+        for (int i = 0; i < _voices; i++) {
+            Voice *v = &_v[i];
+            if (!v->notes) {
+                continue;
+            }
+            if (v->phase < v->duty) {
+                // Linear fade in at the start and out at the end of each note
+                uint32_t gain = FULL_GAIN;
+                uint32_t left = v->length - v->elapsed;
+                if (v->elapsed < v->attack) {
+                    gain = gain * v->elapsed / v->attack;
+                }
+                if (left < v->release) {
+                    gain = gain * left / v->release;
+                }
+                sum += (gain * v->volume) >> 8;
+            }
+            v->phase += v->inc;
+            if (++v->elapsed >= v->length) {
+                v->idx++;
+                startNote(v);
+            }
+        }
+        buf[s] = ((sum / _voices) * _top) >> 16;
+    }
+}
+
+void __not_in_flash_func(PolyTone::_irq)() {
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (_polyMap[i] && dma_channel_get_irq1_status(i)) {
+            dma_channel_acknowledge_irq1(i);
+            PolyTone *p = _polyMap[i];
+            // This channel just finished and the other one is now playing, so refill and rearm this one
+            int which = (p->_dma[0] == i) ? 0 : 1;
+            p->fill(p->_buf[which]);
+            dma_channel_set_read_addr(i, p->_buf[which], false);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/*
+    DMA driven tone sequencing for the Raspberry Pi Pico RP2040
+
+    Copyright (c) 2024 Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "ToneNote.h"
+
+// Mixes up to 8 independent voices, each playing its own note list, onto one
+// pin as PWM.  Samples are generated a block at a time from a DMA interrupt,
+// so the CPU is only woken every few milliseconds and never per note.  An
+// RC low-pass (e.g. 1K + 100nF) on the pin before the amplifier is recommended.
+class PolyTone {
+public:
+    static constexpr int MAX_VOICES = 8;
+
+    PolyTone(pin_size_t pin, int voices = 4);
+    ~PolyTone();
+
+    // The PWM carrier runs at the sample rate, so keep it above hearing
+    bool begin(int sampleRate = 32000);
+    void end();
+
+    // Starts the list on the voice at the next block, replacing anything it was playing.
+    // The notes are read while playing and must stay valid until done or stopped
+    bool play(int voice, const ToneNote *notes, size_t count, bool loop = false);
+    void stop(int voice);
+    bool playing(int voice);
+    bool playing();
+
+    // 0-255, default 255
+    void setVolume(int voice, uint8_t volume);
+
+    // Linear fade in and out of every note, default 5ms each, 0 for none.  At most 65535 samples (2s at 32KHz)
+    void setEnvelope(int voice, uint16_t attackMs, uint16_t releaseMs);
+
+private:
+    static constexpr int BLOCK = 256;          // Samples per DMA buffer
+    static constexpr uint32_t FULL_GAIN = 65535;
+
+    typedef struct {
+        const ToneNote *notes;
+        size_t count;
+        size_t idx;
+        bool loop;
+        // Handed over from play()/stop() to the DMA IRQ
+        const ToneNote *volatile nextNotes;
+        size_t nextCount;
+        bool nextLoop;
+        volatile bool nextPending;
+
+        uint32_t phase;
+        uint32_t inc;       // Phase increment per sample, 2^32 == 1 period
+        uint32_t duty;      // Phase below which the output is HIGH
+        uint32_t length;    // Samples in this note
+        uint32_t elapsed;
+        uint32_t attack;    // Samples
+        uint32_t release;
+        uint8_t volume;
+        uint16_t attackMs;
+        uint16_t releaseMs;
+    } Voice;
+
+    void startNote(Voice *v);
+    void fill(uint16_t *buf);
+    static void _irq();
+
+    pin_size_t _pin;
+    int _voices;
+    bool _running;
+    uint32_t _rate;
+    uint32_t _top;
+    int _dma[2];
+    Voice _v[MAX_VOICES];
+    uint16_t _buf[2][BLOCK];
+};
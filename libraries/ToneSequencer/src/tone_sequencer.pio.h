@@ -0,0 +1,59 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// -------------- //
+// tone_sequencer //
+// -------------- //
+
+#define tone_sequencer_wrap_target 0
+#define tone_sequencer_wrap 11
+
+static const uint16_t tone_sequencer_program_instructions[] = {
+    //     .wrap_target
+    0x80a0, //  0: pull   block
+    0xa047, //  1: mov    y, osr
+    0x80a0, //  2: pull   block
+    0xa0c7, //  3: mov    isr, osr
+    0x80a0, //  4: pull   block
+    0xa026, //  5: mov    x, isr
+    0x0029, //  6: jmp    !x, 9
+    0xb842, //  7: nop                    side 1
+    0x0048, //  8: jmp    x--, 8
+    0xb027, //  9: mov    x, osr          side 0
+    0x004a, // 10: jmp    x--, 10
+    0x0085, // 11: jmp    y--, 5
+    //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program tone_sequencer_program = {
+    .instructions = tone_sequencer_program_instructions,
+    .length = 12,
+    .origin = -1,
+};
+
+static inline pio_sm_config tone_sequencer_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + tone_sequencer_wrap_target, offset + tone_sequencer_wrap);
+    sm_config_set_sideset(&c, 2, true, false);
+    return c;
+}
+
+static inline void tone_sequencer_program_init(PIO pio, uint sm, uint offset, uint pin) {
+   pio_gpio_init(pio, pin);
+   pio_sm_set_pins_with_mask(pio, sm, 0, 1u << pin);
+   pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, true);
+   pio_sm_config c = tone_sequencer_program_get_default_config(offset);
+   sm_config_set_sideset_pins(&c, pin);
+   sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+   pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif
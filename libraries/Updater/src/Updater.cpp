@@ -23,6 +23,7 @@
 #include "StackThunk.h"
 #include "LittleFS.h"
 #include <hardware/flash.h>
+#include <FlashBatch.h>
 #include <PicoOTA.h>
 
 #include <Updater_Signing.h>
@@ -291,12 +292,14 @@ bool UpdaterClass::_writeBuffer() {
             return false;
         }
     } else {
-        noInterrupts();
-        rp2040.idleOtherCore();
-        flash_range_erase((intptr_t)_currentAddress - (intptr_t)XIP_BASE, 4096);
-        flash_range_program((intptr_t)_currentAddress - (intptr_t)XIP_BASE, _buffer, 4096);
-        rp2040.resumeOtherCore();
-        interrupts();
+        FlashBatch b;
+        if (!b.erase((intptr_t)_currentAddress - (intptr_t)XIP_BASE, 4096) ||
+                !b.program((intptr_t)_currentAddress - (intptr_t)XIP_BASE, _buffer, 4096)) {
+            b.clear();
+            _setError(UPDATE_ERROR_WRITE);
+            return false;
+        }
+        b.commit();
     }
     if (!_verify) {
         _md5.add(_buffer, _bufferLen);
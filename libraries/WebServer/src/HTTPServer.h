@@ -230,6 +230,7 @@ protected:
     // for extracting Auth parameters
     String _extractParam(String& authReq, const String& param, const char delimit = '"');
 
+    // Allocated as arrays sized per request, so not a fit for ObjectPool
     struct RequestArgument {
         String key;
         String value;
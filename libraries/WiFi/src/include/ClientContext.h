@@ -27,8 +27,15 @@ class WiFiClient;
 typedef void (*discard_cb_t)(void*, ClientContext*);
 
 #include <assert.h>
+#include <ObjectPool.h>
+#include <CoreTrace.h>
 #include "lwip/timeouts.h"
 
+// Number of TCP connections kept in a preallocated pool instead of the heap, 0 to disable
+#ifndef CLIENTCONTEXT_POOL_SIZE
+#define CLIENTCONTEXT_POOL_SIZE 0
+#endif
+
 //#include <esp_priv.h>
 //#include <coredecls.h>
 
@@ -43,7 +50,7 @@ inline void esp_delay(const uint32_t timeout_ms, T&& blocked, const uint32_t int
     }
 }
 
-class ClientContext {
+class ClientContext : public PoolAllocated<ClientContext, CLIENTCONTEXT_POOL_SIZE> {
 public:
     ClientContext(tcp_pcb* pcb, discard_cb_t discard_cb, void* discard_cb_arg) :
         _pcb(pcb), _rx_buf(0), _rx_buf_offset(0), _discard_cb(discard_cb), _discard_cb_arg(discard_cb_arg), _refcnt(0), _next(0),
@@ -368,6 +375,7 @@ public:
         if (!_pcb) {
             return 0;
         }
+        CORE_TRACE(CORE_TRACE_TCP_WRITE, this, dl);
         return _write_from_source(ds, dl);
     }
 
@@ -601,6 +609,7 @@ protected:
         (void) pcb;
         (void) len;
         DEBUGV(":ack %d\r\n", len);
+        CORE_TRACE(CORE_TRACE_TCP_ACKED, this, len);
         _write_some_from_cb();
         return ERR_OK;
     }
@@ -647,6 +656,7 @@ protected:
             }
         }
 
+        CORE_TRACE(CORE_TRACE_TCP_RECV, this, pb->tot_len);
         if (_rx_buf) {
             DEBUGV(":rch %d, %d\r\n", _rx_buf->tot_len, pb->tot_len);
             pbuf_cat(_rx_buf, pb);
@@ -29,15 +29,21 @@ extern "C" {
 
 #include <AddrList.h>
 #include <Arduino.h>
+#include <ObjectPool.h>
 #include "lwip/timeouts.h"
 
+// Number of UDP sockets kept in a preallocated pool instead of the heap, 0 to disable
+#ifndef UDPCONTEXT_POOL_SIZE
+#define UDPCONTEXT_POOL_SIZE 0
+#endif
+
 //#include <PolledTimeout.h>
 
 #define PBUF_ALIGNER_ADJUST 4
 #define PBUF_ALIGNER(x) ((void*)((((intptr_t)(x))+3)&~3))
 #define PBUF_HELPER_FLAG 0xff // lwIP pbuf flag: u8_t
 
-class UdpContext {
+class UdpContext : public PoolAllocated<UdpContext, UDPCONTEXT_POOL_SIZE> {
 public:
 
     typedef std::function<void(void)> rxhandler_t;
@@ -0,0 +1,50 @@
+// Runs several blocking-style tasks on core 0 alongside loop().  Each one
+// only suspends itself when it calls delay() or AsyncTask::waitFor().
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <AsyncTask.h>
+
+volatile bool go = false;
+
+AsyncTask blinker([]() {
+  pinMode(LED_BUILTIN, OUTPUT);
+  while (true) {
+    digitalWrite(LED_BUILTIN, HIGH);
+    delay(100);
+    digitalWrite(LED_BUILTIN, LOW);
+    delay(400);
+  }
+});
+
+AsyncTask counter([]() {
+  for (int i = 0; i < 10; i++) {
+    Serial.printf("Counter %d\n", i);
+    delay(1000);
+  }
+  Serial.println("Counter done");
+});
+
+AsyncTask waiter([]() {
+  // Not switched back to until go becomes true
+  AsyncTask::waitFor([]() {
+    return go;
+  });
+  Serial.println("Waiter saw go");
+});
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  blinker.begin();
+  counter.begin();
+  waiter.begin();
+}
+
+void loop() {
+  static uint32_t start = millis();
+  if (!go && (millis() - start > 3000)) {
+    go = true;
+  }
+  delay(10); // The tasks run while loop() waits here
+}
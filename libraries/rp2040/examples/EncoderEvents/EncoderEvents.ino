@@ -0,0 +1,55 @@
+// Counts a quadrature encoder on GP2/GP3 using the GPIO edge-event queue.
+// The interrupt is serviced on core 1 and only records each edge, so very
+// high edge rates can be handled.  The decoding happens later in loop().
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#define PIN_A 2
+#define PIN_B 3
+
+volatile bool ready = false;
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(PIN_A, INPUT_PULLUP);
+  pinMode(PIN_B, INPUT_PULLUP);
+  while (!ready) {
+    delay(1);
+  }
+}
+
+void setup1() {
+  attachInterruptEvent(PIN_A, CHANGE);
+  attachInterruptEvent(PIN_B, CHANGE);
+  ready = true;
+}
+
+void loop1() {
+  // Nothing to do, the IRQs do all the work
+}
+
+void loop() {
+  static long position = 0;
+  static uint8_t state = 0;
+  static uint32_t lastPrint = 0;
+  // Transition table indexed by (old AB << 2) | new AB
+  static const int8_t step[16] = { 0, 1, -1, 0, -1, 0, 0, 1, 1, 0, 0, -1, 0, -1, 1, 0 };
+
+  GPIOEvent ev;
+  while (readInterruptEvent(&ev)) {
+    uint8_t bit = (ev.pin == PIN_A) ? 2 : 1;
+    uint8_t next = state;
+    if (ev.mode == RISING) {
+      next |= bit;
+    } else if (ev.mode == FALLING) {
+      next &= ~bit;
+    } else {
+      continue; // Glitch, the other pin will resync us
+    }
+    position += step[(state << 2) | next];
+    state = next;
+  }
+  if (millis() - lastPrint > 500) {
+    lastPrint = millis();
+    Serial.printf("Position: %ld, dropped events: %lu\n", position, droppedInterruptEvents());
+  }
+}
@@ -0,0 +1,49 @@
+// Shows core 1 continuing to generate a square wave from RAM while core 0
+// is writing files to LittleFS, and reports how long core 1 was parked.
+// Connect a scope or logic analyzer to GPIO 2 to see the output.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <LittleFS.h>
+#include <FlashBatch.h>
+
+#define PIN 2
+
+// Runs in RAM and only touches SIO and the timer, so it is safe while flash is busy
+static void __not_in_flash_func(toggle)() {
+  static uint32_t last = 0;
+  uint32_t now = timer_hw->timerawl;
+  if (now - last >= 500) {
+    sio_hw->gpio_togl = 1 << PIN;
+    last = now;
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  LittleFS.begin();
+}
+
+void loop() {
+  FlashBatch::resetStats();
+  File f = LittleFS.open("/log.bin", "w");
+  uint8_t buf[512];
+  memset(buf, 0xa5, sizeof(buf));
+  for (int i = 0; i < 64; i++) {
+    f.write(buf, sizeof(buf));
+  }
+  f.close();
+  FlashBatch::Stats s = FlashBatch::stats();
+  Serial.printf("Core 1 parked %lu times, longest %luus, total %lluus\n", s.count, s.maxUs, s.totalUs);
+  delay(2000);
+}
+
+void setup1() {
+  pinMode(PIN, OUTPUT);
+  rp2040.setParkedCallback(toggle);
+}
+
+void loop1() {
+  toggle();
+}
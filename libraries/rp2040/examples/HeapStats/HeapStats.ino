@@ -0,0 +1,40 @@
+// Shows heap usage, fragmentation, and which code is allocating the most.
+// Copy the addresses printed to "arm-none-eabi-addr2line -f -e HeapStats.ino.elf"
+// to see which functions they are in.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <HeapStats.h>
+
+// Count allocations from up to 64 different places in the code
+size_t heap_stats_callers = 64;
+
+char *keep[32];
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+}
+
+void loop() {
+  // Build up some Strings, which grow a piece at a time
+  String s;
+  for (int i = 0; i < 50; i++) {
+    s += String(i);
+  }
+
+  // Leave every other small block allocated between larger ones to fragment the heap
+  for (int i = 0; i < 32; i++) {
+    free(keep[i]);
+    keep[i] = (char *)malloc((i & 1) ? 32 : 1000);
+  }
+  for (int i = 0; i < 32; i += 2) {
+    free(keep[i]);
+    keep[i] = nullptr;
+  }
+
+  HeapStats::report(Serial);
+  Serial.printf("Free %d, largest block %d, %d%% fragmented\n\n", rp2040.getFreeHeap(),
+                rp2040.getMaxFreeBlockSize(), rp2040.getHeapFragmentation());
+  delay(5000);
+}
@@ -0,0 +1,59 @@
+// Benchmarks small allocations running on both cores at once.  Build once
+// as-is to use the per-core heap caches, then comment out the
+// percore_heap_cache line and build again to compare with the shared heap.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+// Bytes of small-block cache per core, 0 (or removing the line) disables it
+size_t percore_heap_cache = 16384;
+
+const int SLOTS = 32;
+const int ROUNDS = 20000;
+
+volatile bool go = false;
+volatile uint32_t cycles[2];
+
+// Mixed sizes like String, std::function and lwIP pbuf headers would use
+void churn() {
+  void *slot[SLOTS] = {};
+  uint32_t seed = rp2040.cpuid() + 1;
+  uint32_t start = rp2040.getCycleCount();
+  for (int i = 0; i < ROUNDS; i++) {
+    seed = seed * 1103515245 + 12345;
+    int s = (seed >> 16) % SLOTS;
+    free(slot[s]);
+    slot[s] = malloc(8 + ((seed >> 8) & 0xf8));
+  }
+  for (int s = 0; s < SLOTS; s++) {
+    free(slot[s]);
+  }
+  cycles[rp2040.cpuid()] = rp2040.getCycleCount() - start;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+}
+
+void loop() {
+  cycles[0] = 0;
+  cycles[1] = 0;
+  go = true;
+  churn();
+  while (!cycles[1]) {
+    /* noop */
+  }
+  go = false;
+  Serial.printf("Cache %s: core 0 %.1f cycles/op, core 1 %.1f cycles/op\n", percore_heap_cache ? "on" : "off",
+                (float)cycles[0] / ROUNDS, (float)cycles[1] / ROUNDS);
+  delay(1000);
+}
+
+void setup1() {
+}
+
+void loop1() {
+  if (go && !cycles[1]) {
+    churn();
+  }
+}
@@ -0,0 +1,156 @@
+// Compares rp2040.fifo with the SPSCQueue and MPMCQueue templates for
+// sending data from core 0 to core 1.  Measures round trip latency with a
+// ping-pong between the cores, and throughput for 32-bit values and for a
+// 32-byte struct (which needs 8 separate fifo pushes).
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <CoreQueue.h>
+
+typedef struct {
+  uint32_t seq;
+  uint32_t when;
+  float data[6];
+} Message;
+
+SPSCQueue<uint32_t, 64> spscTo1, spscTo0;
+MPMCQueue<uint32_t, 64> mpmcTo1, mpmcTo0;
+SPSCQueue<Message, 16> msgTo1;
+
+const int PINGS = 1000;
+const int COUNT = 20000;
+
+enum { FIFO_ECHO = 1, SPSC_ECHO, MPMC_ECHO, FIFO_SINK, SPSC_SINK, MSG_SINK, MSG_FIFO_SINK };
+
+void report(const char *name, uint32_t cycles, int count, const char *what) {
+  Serial.printf("%-28s %8lu cycles total, %6.1f cycles/%s\n", name, cycles, (float)cycles / count, what);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  uint32_t start;
+
+  // Round trips
+  rp2040.fifo.push(FIFO_ECHO);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < PINGS; i++) {
+    rp2040.fifo.push(i);
+    rp2040.fifo.pop();
+  }
+  report("fifo ping-pong", rp2040.getCycleCount() - start, PINGS, "round trip");
+
+  rp2040.fifo.push(SPSC_ECHO);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < PINGS; i++) {
+    spscTo1.push(i);
+    spscTo0.pop();
+  }
+  report("SPSCQueue ping-pong", rp2040.getCycleCount() - start, PINGS, "round trip");
+
+  rp2040.fifo.push(MPMC_ECHO);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < PINGS; i++) {
+    mpmcTo1.push(i);
+    mpmcTo0.pop();
+  }
+  report("MPMCQueue ping-pong", rp2040.getCycleCount() - start, PINGS, "round trip");
+
+  // Streaming throughput, core 1 acknowledges once it has received everything
+  rp2040.fifo.push(FIFO_SINK);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < COUNT; i++) {
+    rp2040.fifo.push(i);
+  }
+  rp2040.fifo.pop();
+  report("fifo uint32_t stream", rp2040.getCycleCount() - start, COUNT, "value");
+
+  rp2040.fifo.push(SPSC_SINK);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < COUNT; i++) {
+    spscTo1.push(i);
+  }
+  rp2040.fifo.pop();
+  report("SPSCQueue uint32_t stream", rp2040.getCycleCount() - start, COUNT, "value");
+
+  Message m = {};
+  rp2040.fifo.push(MSG_FIFO_SINK);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < COUNT / 8; i++) {
+    m.seq = i;
+    const uint32_t *w = (const uint32_t *)&m;
+    for (size_t j = 0; j < sizeof(m) / 4; j++) {
+      rp2040.fifo.push(w[j]);
+    }
+  }
+  rp2040.fifo.pop();
+  report("fifo 32-byte messages", rp2040.getCycleCount() - start, COUNT / 8, "message");
+
+  rp2040.fifo.push(MSG_SINK);
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < COUNT / 8; i++) {
+    // Build the message right in the queue, no extra copy
+    Message *p;
+    while (!(p = msgTo1.reserve())) {
+      /* noop */
+    }
+    p->seq = i;
+    p->when = rp2040.getCycleCount();
+    msgTo1.commit();
+  }
+  rp2040.fifo.pop();
+  report("SPSCQueue 32-byte messages", rp2040.getCycleCount() - start, COUNT / 8, "message");
+}
+
+void loop() {
+}
+
+void setup1() {
+}
+
+void loop1() {
+  switch (rp2040.fifo.pop()) {
+    case FIFO_ECHO:
+      for (int i = 0; i < PINGS; i++) {
+        rp2040.fifo.push(rp2040.fifo.pop());
+      }
+      break;
+    case SPSC_ECHO:
+      for (int i = 0; i < PINGS; i++) {
+        spscTo0.push(spscTo1.pop());
+      }
+      break;
+    case MPMC_ECHO:
+      for (int i = 0; i < PINGS; i++) {
+        mpmcTo0.push(mpmcTo1.pop());
+      }
+      break;
+    case FIFO_SINK:
+      for (int i = 0; i < COUNT; i++) {
+        rp2040.fifo.pop();
+      }
+      rp2040.fifo.push(0);
+      break;
+    case SPSC_SINK:
+      for (int i = 0; i < COUNT; i++) {
+        spscTo1.pop();
+      }
+      rp2040.fifo.push(0);
+      break;
+    case MSG_FIFO_SINK:
+      for (int i = 0; i < COUNT / 8 * (int)(sizeof(Message) / 4); i++) {
+        rp2040.fifo.pop();
+      }
+      rp2040.fifo.push(0);
+      break;
+    case MSG_SINK:
+      for (int i = 0; i < COUNT / 8; i++) {
+        while (!msgTo1.peek()) {
+          /* noop */
+        }
+        msgTo1.release();
+      }
+      rp2040.fifo.push(0);
+      break;
+  }
+}
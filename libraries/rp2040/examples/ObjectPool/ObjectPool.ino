@@ -0,0 +1,65 @@
+// Hands events from a timer IRQ to loop() without touching the heap, and
+// compares the cost of a pool allocation against new/delete.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <ObjectPool.h>
+#include <CoreQueue.h>
+
+class Event {
+public:
+  Event(uint32_t when, int count) : when(when), count(count) { }
+  uint32_t when;
+  int count;
+};
+
+// Storage for 16 events is reserved at build time, so this is safe from an IRQ
+ObjectPool<Event, 16> events;
+SPSCQueue<Event *, 16> pending;
+
+// Classes can also take their "new" and "delete" from a pool of their own
+class Packet : public PoolAllocated<Packet, 8> {
+public:
+  uint8_t data[64];
+};
+
+repeating_timer_t timer;
+int ticks = 0;
+
+bool tick(repeating_timer_t *t) {
+  (void) t;
+  Event *e = events.create(micros(), ticks++);
+  if (e && !pending.push_nb(e)) {
+    events.destroy(e);
+  }
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  add_repeating_timer_ms(250, tick, nullptr, &timer);
+}
+
+void loop() {
+  Event *e;
+  while (pending.pop_nb(&e)) {
+    Serial.printf("Event %d at %lu us\n", e->count, e->when);
+    events.destroy(e);
+  }
+
+  uint32_t start = rp2040.getCycleCount();
+  for (int i = 0; i < 1000; i++) {
+    delete new Packet;
+  }
+  uint32_t pool = rp2040.getCycleCount() - start;
+  start = rp2040.getCycleCount();
+  for (int i = 0; i < 1000; i++) {
+    free(malloc(sizeof(Packet)));
+  }
+  uint32_t heap = rp2040.getCycleCount() - start;
+  auto s = events.stats();
+  Serial.printf("Pool %lu cycles/op, heap %lu cycles/op, events in use %u, peak %u, misses %lu\n",
+                pool / 1000, heap / 1000, s.inUse, s.peak, s.misses);
+  delay(1000);
+}
@@ -0,0 +1,53 @@
+// Hands heavy calculations off to core 1 with coreExecutor while core 0
+// keeps blinking the LED and printing.  No setup1()/loop1() is needed, using
+// coreExecutor starts core 1 automatically.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <CoreExecutor.h>
+
+// Deliberately slow
+uint32_t countPrimes(uint32_t limit) {
+  uint32_t cnt = 0;
+  for (uint32_t n = 2; n < limit; n++) {
+    bool prime = true;
+    for (uint32_t d = 2; d * d <= n; d++) {
+      if (!(n % d)) {
+        prime = false;
+        break;
+      }
+    }
+    cnt += prime ? 1 : 0;
+  }
+  return cnt;
+}
+
+void logIt(void *msg) {
+  Serial.printf("C%d: %s\n", rp2040.cpuid(), (const char *)msg);
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(LED_BUILTIN, OUTPUT);
+  delay(5000);
+}
+
+void loop() {
+  static uint32_t limit = 50000;
+
+  // Low priority jobs only run once the higher ones are done
+  coreExecutor.post(logIt, (void *)"low priority job", CoreExecutor::Low);
+  auto primes = coreExecutor.submit([]() {
+    return countPrimes(limit);
+  });
+  coreExecutor.post(logIt, (void *)"high priority job", CoreExecutor::High);
+
+  uint32_t start = millis();
+  while (!primes.ready()) {
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+    delay(50);
+  }
+  Serial.printf("C%d: %lu primes below %lu, took %lums on core 1\n", rp2040.cpuid(), primes.get(), limit, millis() - start);
+  limit += 10000;
+  delay(1000);
+}
@@ -0,0 +1,22 @@
+// Breathes the built-in LED using a DMA-driven PWM waveform.  Once started
+// the CPU isn't involved at all, so loop() is free to do anything else.
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+// 1 level per PWM period.  At 1KHz, 2000 steps give a 2 second breath.
+uint16_t levels[2000];
+
+void setup() {
+  analogWritePinFreq(LED_BUILTIN, 1000);
+  analogWritePinRange(LED_BUILTIN, 1000);
+  for (int i = 0; i < 1000; i++) {
+    // Squaring gives a more natural looking fade
+    levels[i] = (i * i) / 1000;
+    levels[1999 - i] = levels[i];
+  }
+  analogWriteWaveform(LED_BUILTIN, levels, 2000, true);
+}
+
+void loop() {
+  Serial.printf("Still breathing, and loop() is free\n");
+  delay(1000);
+}
@@ -0,0 +1,55 @@
+// Shows how much time each IRQ takes, and where loop() spends its time.
+// Copy the PCs printed to "arm-none-eabi-addr2line -f -e Profiler.ino.elf"
+// to see which functions they are in.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <Profiler.h>
+
+volatile uint32_t edges = 0;
+
+void edge() {
+  edges++;
+}
+
+uint32_t slowSum(int n) {
+  volatile uint32_t sum = 0;
+  for (int i = 0; i < n; i++) {
+    sum += i * i;
+  }
+  return sum;
+}
+
+uint32_t fastSum(int n) {
+  volatile uint32_t sum = 0;
+  for (int i = 0; i < n / 10; i++) {
+    sum += i;
+  }
+  return sum;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+
+  // Generate some GPIO IRQs from a PWM output
+  analogWrite(0, 128);
+  attachInterrupt(digitalPinToInterrupt(0), edge, RISING);
+
+  profiler.begin();
+  profiler.startSampling(2000);
+}
+
+void loop() {
+  for (int i = 0; i < 100; i++) {
+    slowSum(1000);
+    fastSum(1000);
+  }
+  static uint32_t last = millis();
+  if (millis() - last > 5000) {
+    profiler.report(Serial);
+    Serial.printf("%lu GPIO edges\n\n", edges);
+    profiler.reset();
+    last = millis();
+  }
+}
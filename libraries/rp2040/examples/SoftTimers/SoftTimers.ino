@@ -0,0 +1,51 @@
+// Runs a thousand software timers off a single hardware alarm, and reports
+// how accurately they fired.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <TimerWheel.h>
+
+#define TIMERS 1000
+
+volatile uint32_t ticks[TIMERS];
+
+void count(void *arg) {
+  ticks[(int)arg]++;
+}
+
+void blink(void *arg) {
+  (void) arg;
+  digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+}
+
+void report(void *arg) {
+  (void) arg;
+  // Deferred, so it's safe to print from here
+  uint32_t total = 0;
+  for (int i = 0; i < TIMERS; i++) {
+    total += ticks[i];
+  }
+  TimerWheel::Stats s = timerWheel.stats();
+  Serial.printf("%lu callbacks, %lu fired, %lu late, worst %lu us, average %lu us\n", total, s.fired, s.late,
+                s.maxLateUs, s.fired ? (uint32_t)(s.totalLateUs / s.fired) : 0);
+}
+
+SoftTimer timers[TIMERS];
+SoftTimer blinker(blink);
+SoftTimer reporter(report, nullptr, true);
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  pinMode(LED_BUILTIN, OUTPUT);
+  for (int i = 0; i < TIMERS; i++) {
+    // Periods from 10ms to 1s
+    timers[i].setCallback(count, (void *)i);
+    timers[i].start(random(1000, 1000000), random(10000, 1000000));
+  }
+  blinker.start(250000, 250000);
+  reporter.start(1000000, 1000000);
+}
+
+void loop() {
+}
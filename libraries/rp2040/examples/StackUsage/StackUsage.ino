@@ -0,0 +1,39 @@
+// Shows the deepest each core's stack has ever gone, and traps overflows
+// with the MPU instead of letting them corrupt memory.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+// Make the bottom of each stack inaccessible so an overflow HardFaults
+bool core_stack_guard = true;
+
+int recurse(int depth) {
+  volatile char buff[64];
+  buff[0] = depth;
+  if (depth > 0) {
+    return recurse(depth - 1) + buff[0];
+  }
+  return buff[0];
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+}
+
+void loop() {
+  static int depth = 1;
+  recurse(depth);
+  Serial.printf("Core 0: depth %d, high water %d of %d bytes, %d free now\n", depth,
+                rp2040.getStackHighWater(), rp2040.getStackSize(), rp2040.getFreeStack());
+  depth *= 2; // Eventually hits the guard
+  delay(1000);
+}
+
+void setup1() {
+}
+
+void loop1() {
+  recurse(4);
+  delay(5000);
+  Serial.printf("Core 1: high water %d of %d bytes\n", rp2040.getStackHighWater(), rp2040.getStackSize());
+}
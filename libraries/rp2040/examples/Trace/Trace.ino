@@ -0,0 +1,52 @@
+// Records a trace of work done on both cores and streams it over USB.
+// Build with "-DDEBUG_RP2040_TRACE" (e.g. in platformio.ini build_flags)
+// or the trace points are removed.  Capture the serial output to a file
+// and then run
+//     python3 tools/tracedecode.py -i capture.bin -o trace.json -n names.txt
+// with names.txt containing:
+//     0x1000 work
+//     0x1001 queue
+// and open trace.json in chrome://tracing or https://ui.perfetto.dev
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+#include <CoreTrace.h>
+
+enum {
+  TRACE_WORK = CORE_TRACE_USER,
+  TRACE_QUEUE
+};
+
+void work(int n) {
+  CORE_TRACE_BEGIN(TRACE_WORK, n, 0);
+  delayMicroseconds(100 + random(400));
+  CORE_TRACE_END(TRACE_WORK, n, 0);
+}
+
+void setup() {
+  Serial.begin(115200);
+  CoreTrace::begin(1024);
+}
+
+void loop() {
+  static int n = 0;
+  work(n);
+  rp2040.fifo.push_nb(n++); // Hand some work to core 1 too
+
+  static uint32_t last = millis();
+  if (millis() - last > 100) {
+    CoreTrace::dump(Serial);
+    last = millis();
+  }
+}
+
+void setup1() {
+}
+
+void loop1() {
+  uint32_t n;
+  CORE_TRACE_COUNTER(TRACE_QUEUE, rp2040.fifo.available());
+  if (rp2040.fifo.pop_nb(&n)) {
+    work(n);
+  }
+}
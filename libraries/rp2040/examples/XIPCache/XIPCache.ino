@@ -0,0 +1,55 @@
+// Compares the same code running from flash and from RAM, using the XIP
+// cache counters to show how many flash reads each one makes.
+//
+// Released to the public domain by Earle F. Philhower, III <earlephilhower@yahoo.com>
+
+uint32_t crcFlash(const uint8_t *p, size_t len) {
+  uint32_t crc = 0xffffffff;
+  while (len--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+// Identical, but copied to RAM at boot
+uint32_t __not_in_flash_func(crcRAM)(const uint8_t *p, size_t len) {
+  uint32_t crc = 0xffffffff;
+  while (len--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+uint8_t buff[4096];
+
+void measure(const char *name, uint32_t (*fn)(const uint8_t *, size_t)) {
+  rp2040.resetXIPCacheStats();
+  uint32_t start = rp2040.getCycleCount();
+  uint32_t crc = fn(buff, sizeof(buff));
+  uint32_t cycles = rp2040.getCycleCount() - start;
+  uint32_t acc = rp2040.getXIPCacheAccesses();
+  uint32_t hits = rp2040.getXIPCacheHits();
+  Serial.printf("%-6s crc %08lx, %lu cycles, %lu flash reads, %lu misses (%lu%% hit)\n", name, crc, cycles,
+                acc, acc - hits, acc ? (100 * hits) / acc : 100);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(5000);
+  for (size_t i = 0; i < sizeof(buff); i++) {
+    buff[i] = rand();
+  }
+}
+
+void loop() {
+  measure("Flash", crcFlash);
+  measure("RAM", crcRAM);
+  Serial.println();
+  delay(1000);
+}
@@ -307,6 +307,7 @@ linkerscript_cmd = env.Command(
         "--sub", "__FS_START__", "$FS_START",
         "--sub", "__FS_END__", "$FS_END",
         "--sub", "__RAM_LENGTH__", "%dk" % (ram_size // 1024),
+        "--sub", "__RAM_FILES__", '"%s"' % board.get("build.ram_files", ""),
     ]), "Generating linkerscript $BUILD_DIR/memmap_default.ld")
 )
 
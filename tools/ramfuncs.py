@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# Moves a list of functions from flash into RAM by renaming their sections
+# in the compiled objects and archives from .text.<name> to
+# .time_critical.<name>, which the linker script places in RAM
+# (the same as __not_in_flash_func()).
+#
+# Run before linking.  Names are the (mangled) symbol names, and may use
+# shell wildcards, e.g. "tcp_*" or "*6String*".  Objects and archives in the
+# build directory are changed in place, and what was renamed is recorded in
+# ramfuncs.json there so the next run can put it back first if the file
+# hasn't been rebuilt since.  The prebuilt platform libraries (--lib) are left
+# alone, and a changed copy is written to the build directory instead, which
+# the linker searches first.
+
+import argparse
+import fnmatch
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+
+def elfSections(data):
+    """Returns the section names in a little-endian ELF object"""
+    if data[0:4] != b'\x7fELF' or data[5] != 1:
+        return []
+    if data[4] == 1:
+        shoff = struct.unpack_from('<I', data, 0x20)[0]
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x2e)
+        offFmt, offPos = '<I', 0x10
+    else:
+        shoff = struct.unpack_from('<Q', data, 0x28)[0]
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x3a)
+        offFmt, offPos = '<Q', 0x18
+    if not shoff or shstrndx >= shnum:
+        return []
+    strOff = struct.unpack_from(offFmt, data, shoff + shstrndx * shentsize + offPos)[0]
+    names = []
+    for i in range(shnum):
+        nameOff = struct.unpack_from('<I', data, shoff + i * shentsize)[0]
+        end = data.index(b'\0', strOff + nameOff)
+        names.append(data[strOff + nameOff:end].decode('utf-8', 'replace'))
+    return names
+
+
+def archiveMembers(data):
+    """Yields the contents of each member of a Unix ar archive"""
+    off = 8
+    while off + 60 <= len(data):
+        name = data[off:off + 16]
+        size = int(data[off + 48:off + 58].decode().strip())
+        off += 60
+        if not name.startswith(b'/ ') and not name.startswith(b'// ') and not name.startswith(b'/SYM64/'):
+            yield data[off:off + size]
+        off += size + (size & 1)
+
+
+def sections(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data.startswith(b'!<arch>\n'):
+        names = set()
+        for m in archiveMembers(data):
+            names.update(elfSections(m))
+        return names
+    return set(elfSections(data))
+
+
+def renames(path, patterns, matched):
+    """objcopy arguments to rename the matching sections in a file"""
+    ret = []
+    for s in sorted(sections(path)):
+        if not s.startswith('.text.'):
+            continue
+        hits = [p for p in patterns if fnmatch.fnmatchcase(s[6:], p)]
+        if hits:
+            matched.update(hits)
+            ret += ['--rename-section', '%s=.time_critical.%s' % (s, s[6:])]
+    return ret
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Move functions into RAM')
+    parser.add_argument('-b', '--build', action='store', required=True, help='Build directory holding the objects and archives')
+    parser.add_argument('-c', '--objcopy', action='store', required=True, help='Path to objcopy')
+    parser.add_argument('-f', '--functions', action='store', default='', help='Space separated function names or wildcards')
+    parser.add_argument('-l', '--lib', action='append', default=[], help='Prebuilt library to copy into the build directory if it has any of the functions')
+    args = parser.parse_args()
+
+    patterns = args.functions.split()
+    matched = set()
+    moved = 0
+
+    # Undo the last run, so names taken off the list go back to flash.  A file
+    # whose time changed since has been recompiled and has nothing of ours in it
+    state = os.path.join(args.build, 'ramfuncs.json')
+    try:
+        with open(state, 'r') as f:
+            last = json.load(f)
+    except (OSError, ValueError):
+        last = {}
+    for path, (mtime, names) in last.items():
+        if os.path.exists(path) and os.stat(path).st_mtime_ns == mtime:
+            r = []
+            for n in names:
+                r += ['--rename-section', '.time_critical.%s=.text.%s' % (n, n)]
+            subprocess.check_call([args.objcopy] + r + [path])
+    changed = {}
+
+    copies = set()
+    for lib in args.lib:
+        copy = os.path.join(args.build, os.path.basename(lib))
+        copies.add(os.path.abspath(copy))
+        r = renames(lib, patterns, matched) if (patterns and os.path.exists(lib)) else []
+        if r:
+            # Always start again from the original, so names taken off the list go back to flash
+            shutil.copyfile(lib, copy)
+            subprocess.check_call([args.objcopy] + r + [copy])
+            moved += len(r) // 2
+        elif os.path.exists(copy):
+            os.remove(copy)
+
+    if patterns:
+        for root, dirs, files in os.walk(args.build):
+            for f in files:
+                path = os.path.join(root, f)
+                if not (f.endswith('.o') or f.endswith('.a')) or (os.path.abspath(path) in copies):
+                    continue
+                r = renames(path, patterns, matched)
+                if r:
+                    subprocess.check_call([args.objcopy] + r + [path])
+                    moved += len(r) // 2
+                    changed[path] = [os.stat(path).st_mtime_ns, [a.split('=')[0][6:] for a in r[1::2]]]
+
+    if changed:
+        with open(state, 'w') as f:
+            json.dump(changed, f)
+    elif os.path.exists(state):
+        os.remove(state)
+
+    for p in patterns:
+        if p not in matched:
+            print("Warning: no function matching '%s' found to move to RAM" % p)
+    if patterns:
+        print("Moved %d functions to RAM" % moved)
+
+
+main()
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Converts the binary output of CoreTrace::dump() into Chrome trace JSON,
+# which can be opened in chrome://tracing or https://ui.perfetto.dev
+#
+# The input may have other text (e.g. Serial.print output) mixed in between
+# the trace chunks, it is skipped.
+#
+# Usage: tracedecode.py -i trace.bin -o trace.json [-n names.txt]
+#   names.txt has one "<id> <name>" per line (ids in decimal or 0x hex) to
+#   label events from CORE_TRACE_USER up
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b'RPTR'
+HEADER = struct.Struct('<4sHH')
+RECORD = struct.Struct('<IHBBII')
+
+INSTANT, BEGIN, END, COUNTER = range(4)
+
+CORE_NAMES = {
+    0: 'trace dropped',
+    1: 'lwIP wait',
+    2: 'lwIP lock',
+    3: 'TCP write',
+    4: 'TCP recv',
+    5: 'TCP acked',
+    6: 'Audio IRQ',
+    7: 'Flash commit',
+}
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='CoreTrace to Chrome trace JSON converter')
+    parser.add_argument('-i', '--input', help='Binary trace input (default stdin)')
+    parser.add_argument('-o', '--output', help='JSON output (default stdout)')
+    parser.add_argument('-n', '--names', help='File of "<id> <name>" lines for user events')
+    return parser.parse_args()
+
+def load_names(path):
+    names = dict(CORE_NAMES)
+    if path:
+        with open(path) as f:
+            for line in f:
+                line = line.split('#')[0].strip()
+                if line:
+                    ident, name = line.split(None, 1)
+                    names[int(ident, 0)] = name.strip()
+    return names
+
+def records(data):
+    """Yields (us, id, kind, core, a, b) for every record in every chunk found."""
+    pos = 0
+    while True:
+        pos = data.find(MAGIC, pos)
+        if pos < 0 or pos + HEADER.size > len(data):
+            return
+        _, version, count = HEADER.unpack_from(data, pos)
+        end = pos + HEADER.size + count * RECORD.size
+        if version != 1 or end > len(data):
+            pos += 1  # Not really a chunk, or a truncated one
+            continue
+        for i in range(count):
+            yield RECORD.unpack_from(data, pos + HEADER.size + i * RECORD.size)
+        pos = end
+
+def convert(data, names):
+    events = []
+    last = {}
+    wraps = {}
+    for us, ident, kind, core, a, b in records(data):
+        # Timestamps are 32-bit microseconds, so unwrap them every ~71 minutes
+        if core in last and us < last[core] and last[core] - us > 0x80000000:
+            wraps[core] = wraps.get(core, 0) + 1
+        last[core] = us
+        ts = us + (wraps.get(core, 0) << 32)
+        name = names.get(ident, 'event 0x%04x' % ident)
+        ev = {'name': name, 'pid': 0, 'tid': core, 'ts': ts}
+        if kind == BEGIN:
+            ev['ph'] = 'B'
+            ev['args'] = {'a': a, 'b': b}
+        elif kind == END:
+            ev['ph'] = 'E'
+            ev['args'] = {'a': a, 'b': b}
+        elif kind == COUNTER:
+            ev['ph'] = 'C'
+            ev['args'] = {'value': a}
+        else:
+            ev['ph'] = 'i'
+            ev['s'] = 't'
+            ev['args'] = {'a': a, 'b': b}
+        events.append(ev)
+    events.sort(key=lambda e: e['ts'])
+    meta = [{'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': c, 'args': {'name': 'Core %d' % c}} for c in (0, 1)]
+    return {'traceEvents': meta + events, 'displayTimeUnit': 'ms'}
+
+def main():
+    args = parse_args()
+    if args.input:
+        with open(args.input, 'rb') as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    trace = convert(data, load_names(args.names))
+    out = open(args.output, 'w') if args.output else sys.stdout
+    json.dump(trace, out)
+    if args.output:
+        out.close()
+    sys.stderr.write('%d events\n' % (len(trace['traceEvents']) - 2))
+
+if __name__ == '__main__':
+    main()